@@ -89,6 +89,9 @@ int main()
 
         timer -= delta.count();
 
+        // Needed every frame, this is what keeps the sources and their callbacks going
+        Hazel::Audio::Update();
+
         using namespace std::literals::chrono_literals;
         std::this_thread::sleep_for(5ms);
     }
@@ -2,60 +2,400 @@
 
 #pragma once
 
+#include <functional>
+#include <future>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <vector>
 
 namespace Hazel::Audio
 {
-    bool Init();
+    struct InitSettings
+    {
+        uint32_t DecodeThreads{}; // workers for async loads, 0 picks one per hardware thread minus one
+        // Decoded PCM of loaded files is kept here and mapped on later runs instead of decoding again.
+        // Entries are invalidated when the source file's size or modification time changes. Empty disables it
+        std::string PcmCacheDirectory;
+        // Sources and one-shots beyond this many only play virtually, the most audible ones get
+        // real AL sources in Update(). That many AL sources are created in Init and never more,
+        // if the device can't provide them all this is lowered to what it could (256 with OpenAL Soft)
+        uint32_t MaxVoices{128};
+        // AL buffers created in Init for clips and streams, each decoded clip uses one and each playing
+        // stream four. More are created in batches if these run out
+        uint32_t BufferCapacity{64};
+    };
+
+    // Update() has to be called regularly from then on, see below
+    bool Init(const InitSettings& settings = {});
     void Shutdown();
 
+    // Required, call once per frame from the thread that called Init. Finishes async loads, advances
+    // virtual voices, recycles the sources of finished one-shots, runs OnFinished callbacks and hands
+    // the AL sources to whichever voices are most audible. Without it none of that ever happens
+    void Update();
+
+    // Property changes made between these reach the mixer together at EndUpdate instead of one
+    // at a time, e.g. when moving a lot of sources in a frame. Pairs can nest, only the outermost
+    // one counts. Update() already batches its own changes
+    void BeginUpdate();
+    void EndUpdate();
+
     void SetGlobalVolume(float volume);
 
+    // Mixer buses form a tree below the master bus, e.g. Music, SFX, Voice and UI. A source's gain is
+    // scaled by the volume of its bus and of every bus above it. Volume changes are applied in Update()
+    // in one batch, only to the voices on buses that actually changed. Buses are created after Init
+    using BusHandle = uint32_t;
+    constexpr BusHandle MasterBus = 0;
+    constexpr BusHandle InvalidBus = ~0u;
+
+    BusHandle CreateBus(const std::string& name, BusHandle parent = MasterBus);
+    [[nodiscard]] BusHandle FindBus(const std::string& name); // InvalidBus if there's none by that name
+    void SetBusVolume(BusHandle bus, float volume);
+    [[nodiscard]] float GetBusVolume(BusHandle bus);
+
+    // Limits how many voices of a category get real AL sources, the rest play virtually. Categories
+    // are plain numbers picked by the game (e.g. an enum of music, dialogue and effects), voices start
+    // out in category 0. Every category is unlimited until given a budget
+    void SetCategoryVoiceBudget(uint32_t category, uint32_t maxVoices);
+
+    // Only counts memory on the app side. What the AL buffers hold isn't included, and ADPCM clips
+    // take the full 16-bit size there since OpenAL Soft expands them on upload
+    struct MemoryStats
+    {
+        size_t DecodeBytes{};     // PCM currently held outside of OpenAL, by loads in flight and streaming chunks
+        size_t PeakDecodeBytes{}; // highest DecodeBytes has been so far
+    };
+
+    [[nodiscard]] MemoryStats GetMemoryStats();
+
+    // Currently supported file formats
+    enum class AudioFileFormat
+    {
+        None = 0,
+        Ogg,
+        MP3
+    };
+
+    // Pluggable input for audio that doesn't live in a plain file, e.g. inside a pak archive
+    class AudioReader
+    {
+    public:
+        virtual ~AudioReader() = default;
+
+        // Returns the number of bytes read, 0 at the end of the data
+        virtual size_t Read(void* buffer, size_t size) = 0;
+        virtual bool Seek(uint64_t position) = 0; // absolute, in bytes
+        [[nodiscard]] virtual uint64_t Tell() const = 0;
+        [[nodiscard]] virtual uint64_t GetSize() const = 0;
+    };
+
+    // Streamed clips need an independent reader for every Source playing them
+    using AudioReaderFactory = std::function<std::unique_ptr<AudioReader>()>;
+
+    // Trades memory for CPU per clip. Compressed is typically 8-12x smaller than Decoded,
+    // but like Streamed it costs a decoder on the refill thread for every Source playing it
+    enum class ClipStorage
+    {
+        Decoded = 0, // whole file decoded into one AL buffer on load
+        Streamed,    // decoded from disk in small chunks while playing, Source only
+        Compressed   // original file kept in memory and decoded in small chunks while playing, Source only
+    };
+
+    // How a clip's samples are stored in OpenAL. Float32 keeps the decoders' float output as is, skipping
+    // the conversion to 16-bit and back in the mixer along with the clipping it causes, at twice the memory.
+    // The ADPCM formats are transcoded on load at a quarter of the size of Int16, lossy. OpenAL Soft expands
+    // them back to 16-bit when the buffer is filled, so they shrink the PCM cache and everything up to the
+    // upload rather than the AL buffer. Streamed and compressed clips play them as Int16
+    enum class SampleFormat
+    {
+        Int16 = 0,
+        Float32,
+        Ima4,   // IMA ADPCM
+        MsAdpcm // Microsoft ADPCM, usually a little cleaner than IMA4
+    };
+
+    class AudioClip;
+    class AudioDecoder;
+    struct DecodedAudio;
+    struct Mp3SeekIndex;
+    struct VoiceState;
+
+    // Receives nullptr if the file couldn't be loaded
+    using ClipLoadCallback = std::function<void(const std::shared_ptr<AudioClip>& clip)>;
+    using PreloadProgressCallback = std::function<void(size_t completed, size_t total)>;
+
+    struct PreloadError
+    {
+        std::string Filename;
+        std::string Message;
+    };
+
+    struct PreloadResult
+    {
+        std::vector<std::shared_ptr<AudioClip>> Clips; // same order as the input, nullptr where loading failed
+        std::vector<PreloadError> Errors;
+    };
+
+    // Decodes all files in parallel on the worker pool and uploads them on the calling thread,
+    // returning once everything is loaded. The progress callback also runs on the calling thread.
+    // The clip cache only holds weak references, keep the returned clips alive for as long as they're needed
+    PreloadResult PreloadClips(const std::vector<std::string>& filenames, const PreloadProgressCallback& progress = {});
+    // Manifest files list one path per line, relative to the manifest. Blank lines and lines starting with # are skipped
+    PreloadResult PreloadManifest(const std::string& manifestFilename, const PreloadProgressCallback& progress = {});
+
+    // Immutable audio data, shared by every Source and one-shot playing it
+    class AudioClip
+    {
+    public:
+        AudioClip(const AudioClip&&) = delete;
+        AudioClip(const AudioClip&) = delete;
+        ~AudioClip();
+
+        // Decoded clips are cached by canonical path, loading the same file twice returns the same clip
+        static std::shared_ptr<AudioClip> LoadFromFile(const std::string& filename, ClipStorage storage = ClipStorage::Decoded,
+                                                       SampleFormat sampleFormat = SampleFormat::Int16);
+        // Decodes on the worker pool, only the upload to OpenAL happens in Update(), which then
+        // completes the future and runs the callback. Don't block on the future from the Update() thread
+        // Without Init() the future is ready with nullptr right away and the callback never runs
+        static std::shared_future<std::shared_ptr<AudioClip>> LoadFromFileAsync(const std::string& filename,
+                                                                                 ClipLoadCallback callback = {},
+                                                                                 SampleFormat sampleFormat = SampleFormat::Int16);
+        // The data isn't copied. Decoded and compressed clips are done with it once this returns,
+        // streamed clips read from it while playing so it has to outlive them
+        static std::shared_ptr<AudioClip> LoadFromMemory(const void* data, size_t size, AudioFileFormat format,
+                                                         ClipStorage storage = ClipStorage::Decoded,
+                                                         SampleFormat sampleFormat = SampleFormat::Int16);
+        static std::shared_ptr<AudioClip> LoadFromReader(AudioReaderFactory openReader, AudioFileFormat format,
+                                                         ClipStorage storage = ClipStorage::Decoded,
+                                                         SampleFormat sampleFormat = SampleFormat::Int16);
+
+        [[nodiscard]] ClipStorage GetStorage() const;
+        [[nodiscard]] SampleFormat GetSampleFormat() const;
+        [[nodiscard]] const std::string& GetFilename() const;
+        [[nodiscard]] float GetDuration() const; // in seconds
+        [[nodiscard]] uint32_t GetSampleRate() const;
+        [[nodiscard]] uint32_t GetChannels() const;
+        [[nodiscard]] uint32_t GetBufferHandle() const;
+
+    private:
+        AudioClip() = default;
+
+        static std::shared_ptr<AudioClip> Upload(const DecodedAudio& audio);
+        static std::shared_ptr<AudioClip> CreateStreamed(std::unique_ptr<AudioDecoder> decoder, SampleFormat sampleFormat);
+        static std::shared_ptr<AudioClip> CreateCompressed(std::vector<uint8_t> data, AudioFileFormat format, SampleFormat sampleFormat,
+                                                           std::shared_ptr<const Mp3SeekIndex> seekIndex = {});
+        // For streamed clips, every Source gets its own decoder
+        [[nodiscard]] std::unique_ptr<AudioDecoder> OpenDecoder() const;
+        static std::shared_ptr<AudioClip> AddToCache(const std::shared_ptr<AudioClip>& clip, const std::string& filename,
+                                                     const std::string& key);
+
+        friend bool BindVoice(VoiceState& voice);
+        friend void ProcessCompletedClipLoads();
+        friend PreloadResult PreloadClips(const std::vector<std::string>& filenames, const PreloadProgressCallback& progress);
+
+        ClipStorage mStorage{};
+        SampleFormat mSampleFormat{};
+        AudioFileFormat mFormat{};
+        std::string mFilename;
+        // Where streamed clips loaded from memory or a reader get their data, compressed clips point it at mCompressedData
+        const void* mData{};
+        size_t mDataSize{};
+        std::vector<uint8_t> mCompressedData;
+        AudioReaderFactory mOpenReader;
+        std::shared_ptr<const Mp3SeekIndex> mSeekIndex; // handed to every decoder of a streamed or compressed MP3
+        uint32_t mBufferHandle{}; // 0 for streamed clips
+        uint32_t mSampleRate{};
+        uint32_t mChannels{};
+        float mDuration{}; // in seconds
+        std::string mCacheKey;
+    };
+
+    // 8 byte reference to a source or one-shot. Handles to sources that were destroyed are
+    // detected, every function taking one does nothing for them
+    struct SourceHandle
+    {
+        uint32_t Index{};
+        uint32_t Generation{}; // 0 is never a valid generation
+
+        [[nodiscard]] bool operator==(const SourceHandle& other) const
+        {
+            return Index == other.Index && Generation == other.Generation;
+        }
+        [[nodiscard]] bool operator!=(const SourceHandle& other) const { return !(*this == other); }
+    };
+
+    // Lightweight reference to a fire-and-forget playback started with PlayOneShot.
+    // Becomes a no-op once the sound has finished
+    class Voice
+    {
+    public:
+        Voice() = default;
+
+        void Stop() const;
+
+        void SetPosition(float x, float y, float z) const;
+        void SetGain(float gain) const;
+        void SetPitch(float pitch) const;
+        void SetPriority(int priority) const;
+        void SetCategory(uint32_t category) const;
+
+        [[nodiscard]] bool IsPlaying() const;
+
+    private:
+        explicit Voice(SourceHandle handle);
+
+        friend Voice PlayOneShot(const std::shared_ptr<AudioClip>& clip, float gain);
+        friend Voice PlayOneShot(const std::shared_ptr<AudioClip>& clip, float x, float y, float z, float gain);
+
+        SourceHandle mHandle;
+    };
+
+    // Only decoded clips can be played as one-shots
+    Voice PlayOneShot(const std::shared_ptr<AudioClip>& clip, float gain = 1.0f);
+    Voice PlayOneShot(const std::shared_ptr<AudioClip>& clip, float x, float y, float z, float gain = 1.0f);
+
+    // C-style alternative to Source objects for code that would rather store plain handles, e.g. in an ECS.
+    // These behave exactly like the Source members of the same name, but live until DestroySource
+    [[nodiscard]] SourceHandle CreateSource(std::shared_ptr<AudioClip> clip = {});
+    void DestroySource(SourceHandle source);
+    [[nodiscard]] bool IsSourceValid(SourceHandle source);
+
+    bool SetSourceClip(SourceHandle source, std::shared_ptr<AudioClip> clip);
+    void PlaySource(SourceHandle source);
+    void PauseSource(SourceHandle source);
+    void StopSource(SourceHandle source);
+    void SeekSource(SourceHandle source, float seconds);
+
+    void SetSourcePosition(SourceHandle source, float x, float y, float z);
+    void SetSourceVelocity(SourceHandle source, float x, float y, float z);
+    void SetSourceGain(SourceHandle source, float gain);
+    void SetSourceVolume(SourceHandle source, float volume);
+    void SetSourceBus(SourceHandle source, BusHandle bus);
+    void SetSourcePitch(SourceHandle source, float pitch);
+    void SetSourceSpatial(SourceHandle source, bool spatial);
+    void SetSourceLoop(SourceHandle source, bool loop);
+    void SetSourcePriority(SourceHandle source, int priority);
+    void SetSourceCategory(SourceHandle source, uint32_t category);
+    void SetSourceOnFinished(SourceHandle source, std::function<void()> callback);
+
+    [[nodiscard]] bool IsSourcePlaying(SourceHandle source);
+    [[nodiscard]] bool IsSourcePaused(SourceHandle source);
+    [[nodiscard]] bool IsSourceStopped(SourceHandle source);
+    [[nodiscard]] bool IsSourceVirtual(SourceHandle source);
+    [[nodiscard]] float GetSourcePlaybackPosition(SourceHandle source);
+
+    class Source;
+
+    // Bulk update for emitters kept in structure-of-arrays form. positions and velocities hold count x,y,z
+    // triples and gains count floats, pass nullptr for whatever should be left alone. Everything lands in
+    // one BeginUpdate()/EndUpdate() batch and values that didn't change don't reach OpenAL at all
+    void SetEmitters(const SourceHandle* sources, size_t count, const float* positions, const float* velocities = nullptr,
+                     const float* gains = nullptr);
+    void SetEmitters(Source* const* sources, size_t count, const float* positions, const float* velocities = nullptr,
+                     const float* gains = nullptr);
+    void SetPositions(const SourceHandle* sources, size_t count, const float* positions);
+    void SetPositions(Source* const* sources, size_t count, const float* positions);
+
+    // Starts the sources together with a single alSourcePlayv so they begin on the same sample, e.g. for
+    // layered music stems. Sources that don't get an AL source start out virtual like they would with Play
+    void PlayGroup(const SourceHandle* sources, size_t count);
+    void PlayGroup(Source* const* sources, size_t count);
+
+    // The device clock in nanoseconds, the timeline PlayGroupAt is scheduled on
+    [[nodiscard]] uint64_t GetDeviceClock();
+    // PlayGroup once the device clock reaches startTime. That's checked in Update(), so the start time is
+    // only as precise as the Update() rate, but the sources still start on the same sample as each other
+    void PlayGroupAt(const SourceHandle* sources, size_t count, uint64_t startTime);
+    void PlayGroupAt(Source* const* sources, size_t count, uint64_t startTime);
+
+    // Can be used in any number, playback is virtualized when there are more of them playing
+    // than InitSettings::MaxVoices. Voices with a higher priority keep their AL source over lower
+    // ones no matter how loud they are, between equal priorities the more audible voice wins.
+    // Owns a handle source and destroys it along with itself
     class Source
     {
     public:
         Source();
-        Source(const Source&&) = delete;
         Source(const Source&) = delete;
+        // Moved-from sources are left empty, calls on them do nothing
+        Source(Source&& other) noexcept;
         explicit Source(const std::string& filename);
+        explicit Source(std::shared_ptr<AudioClip> clip);
         ~Source();
 
-        bool LoadFromFile(const std::string& filename);
+        Source& operator=(Source&& other) noexcept;
+
+        bool LoadFromFile(const std::string& filename, ClipStorage storage = ClipStorage::Decoded,
+                          SampleFormat sampleFormat = SampleFormat::Int16);
+        bool SetClip(std::shared_ptr<AudioClip> clip);
 
         void Play() const;
         void Pause() const;
         void Stop() const;
+        // Jumps to a position in seconds, clamped to the clip. A stopped source starts from there the next
+        // time it plays, so Stop() then Seek() then Play() starts anywhere
+        void Seek(float seconds) const;
 
         void SetPosition(float x, float y, float z);
+        void SetVelocity(float x, float y, float z);
         void SetGain(float gain);
         void SetPitch(float pitch);
         void SetSpatial(bool spatial);
         void SetLoop(bool loop);
+        // Multiplies the gain rather than replacing it, e.g. for user volume settings
         void SetVolume(float volume);
+        void SetBus(BusHandle bus);
+        void SetPriority(int priority);
+        void SetCategory(uint32_t category);
+        // Runs from Update() when playback reaches the end of a clip that isn't looping,
+        // not when the source is stopped
+        void SetOnFinished(std::function<void()> callback);
 
         [[nodiscard]] bool IsLoaded() const;
         [[nodiscard]] bool IsPlaying() const;
         [[nodiscard]] bool IsPaused() const;
         [[nodiscard]] bool IsStopped() const;
+        // Playing without an AL source, time still advances but nothing is heard
+        [[nodiscard]] bool IsVirtual() const;
+        // In seconds, follows the AL source sample-accurately while there is one
+        [[nodiscard]] float GetPlaybackPosition() const;
 
+        [[nodiscard]] const std::shared_ptr<AudioClip>& GetClip() const;
+        // Stays owned by the Source, don't pass it to DestroySource
+        [[nodiscard]] SourceHandle GetHandle() const;
         [[nodiscard]] std::pair<uint32_t, uint32_t> GetLengthMinutesAndSeconds() const;
 
     private:
-        bool LoadOgg(const std::string& filename);
-        bool LoadMp3(const std::string& filename);
-
-        uint32_t mBufferHandle{};
-        uint32_t mSourceHandle{};
+        SourceHandle mHandle;
         bool mLoaded{};
-        bool mSpatial{};
+    };
+
+    // Contiguous storage for lots of sources, e.g. one per entity. Indices stay valid until Remove,
+    // which moves the last source into the freed slot
+    class SourcePool
+    {
+    public:
+        SourcePool() = default;
+        explicit SourcePool(size_t capacity);
+
+        void Reserve(size_t capacity);
+        // Returns the index of the new source
+        size_t Add(std::shared_ptr<AudioClip> clip = {});
+        void Remove(size_t index);
+        void Clear();
 
-        float mTotalDuration{}; // in seconds
+        [[nodiscard]] size_t GetSize() const { return mSources.size(); }
+        [[nodiscard]] Source& operator[](size_t index) { return mSources[index]; }
+        [[nodiscard]] const Source& operator[](size_t index) const { return mSources[index]; }
 
-        // Attributes
-        float mPosition[3]{};
-        float mGain{1.0f};
-        float mPitch{1.0f};
-        bool mLoop{};
+        [[nodiscard]] auto begin() { return mSources.begin(); }
+        [[nodiscard]] auto end() { return mSources.end(); }
+        [[nodiscard]] auto begin() const { return mSources.begin(); }
+        [[nodiscard]] auto end() const { return mSources.end(); }
+
+    private:
+        std::vector<Source> mSources;
     };
-} // namespace Hazel::Audio
\ No newline at end of file
+} // namespace Hazel::Audio
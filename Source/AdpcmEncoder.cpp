@@ -0,0 +1,253 @@
+#include "AdpcmEncoder.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <limits>
+
+namespace Hazel::Audio
+{
+    // Tables and arithmetic mirror OpenAL Soft's decoders in al/buffer.cpp, so every
+    // code is chosen by what the decoder will actually reconstruct from it
+    static constexpr int ImaStepSize[89] = {
+        7,     8,     9,     10,    11,    12,    13,    14,    16,    17,    19,    21,    23,    25,    28,
+        31,    34,    37,    41,    45,    50,    55,    60,    66,    73,    80,    88,    97,    107,   118,
+        130,   143,   157,   173,   190,   209,   230,   253,   279,   307,   337,   371,   408,   449,   494,
+        544,   598,   658,   724,   796,   876,   963,   1060,  1166,  1282,  1411,  1552,  1707,  1878,  2066,
+        2272,  2499,  2749,  3024,  3327,  3660,  4026,  4428,  4871,  5358,  5894,  6484,  7132,  7845,  8630,
+        9493,  10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350, 22358, 24633, 27086, 29794, 32767};
+
+    static constexpr int ImaIndexAdjust[8] = {-1, -1, -1, -1, 2, 4, 6, 8};
+
+    static constexpr int MsAdpcmAdaption[16] = {230, 230, 230, 230, 307, 409, 512, 614,
+                                                768, 614, 512, 409, 307, 230, 230, 230};
+
+    static constexpr int MsAdpcmCoefficients[7][2] = {{256, 0},  {512, -256}, {0, 0},     {192, 64},
+                                                      {240, 0},  {460, -208}, {392, -232}};
+
+    // Candidates tried for the first step size of every MS-ADPCM block, on only its first few frames.
+    // Past those the step size has adapted to the signal whichever one it started from
+    static constexpr int MsAdpcmInitialDeltas[] = {16, 64, 256, 1024, 4096};
+    static constexpr uint64_t MsAdpcmDeltaTrialFrames = 32;
+
+    static constexpr uint32_t MaxChannels = 2;
+
+    static void Write16(uint8_t*& out, int value)
+    {
+        *out++ = static_cast<uint8_t>(value & 0xff);
+        *out++ = static_cast<uint8_t>((value >> 8) & 0xff);
+    }
+
+    // Reads past the end of the clip as silence, for the padding in the last block
+    struct PcmInput
+    {
+        const int16_t* Samples{};
+        uint64_t FrameCount{};
+        uint32_t Channels{};
+
+        [[nodiscard]] int Get(uint64_t frame, uint32_t channel) const
+        {
+            return frame < FrameCount ? Samples[frame * Channels + channel] : 0;
+        }
+    };
+
+    struct ImaState
+    {
+        int Sample{};
+        int Index{};
+    };
+
+    static uint32_t EncodeImaNibble(ImaState& state, int target)
+    {
+        // Only 16 codes, trying them all is cheap and always picks the closest one
+        const int step = ImaStepSize[state.Index];
+        uint32_t best{};
+        int bestSample{};
+        int bestError = std::numeric_limits<int>::max();
+        for (uint32_t nibble = 0; nibble < 16; nibble++)
+        {
+            const int magnitude = static_cast<int>(nibble & 7) * 2 + 1;
+            const int sample = std::clamp(state.Sample + (nibble & 8 ? -magnitude : magnitude) * step / 8, -32768, 32767);
+            const int error = std::abs(sample - target);
+            if (error < bestError)
+            {
+                best = nibble;
+                bestSample = sample;
+                bestError = error;
+            }
+        }
+
+        state.Sample = bestSample;
+        state.Index = std::clamp(state.Index + ImaIndexAdjust[best & 7], 0, 88);
+        return best;
+    }
+
+    SampleBuffer EncodeIma4(const int16_t* samples, uint64_t frameCount, uint32_t channels)
+    {
+        assert(channels >= 1 && channels <= MaxChannels);
+
+        const PcmInput input{samples, frameCount, channels};
+        const uint64_t blockCount = (frameCount + Ima4BlockFrames - 1) / Ima4BlockFrames;
+        SampleBuffer encoded(blockCount * GetBlockSize(SampleFormat::Ima4, channels));
+        uint8_t* out = encoded.data();
+
+        // The step index carries over from block to block, only the sample is reset by the header
+        ImaState states[MaxChannels]{};
+        for (uint64_t block = 0; block < blockCount; block++)
+        {
+            const uint64_t first = block * Ima4BlockFrames;
+            for (uint32_t channel = 0; channel < channels; channel++)
+            {
+                states[channel].Sample = input.Get(first, channel);
+                Write16(out, states[channel].Sample);
+                Write16(out, states[channel].Index);
+            }
+
+            // Eight frames at a time, one 32-bit word per channel with the first nibble lowest
+            for (uint64_t frame = first + 1; frame < first + Ima4BlockFrames; frame += 8)
+            {
+                for (uint32_t channel = 0; channel < channels; channel++)
+                {
+                    uint32_t code{};
+                    for (uint32_t i = 0; i < 8; i++)
+                        code |= EncodeImaNibble(states[channel], input.Get(frame + i, channel)) << (i * 4);
+
+                    Write16(out, static_cast<int>(code & 0xffff));
+                    Write16(out, static_cast<int>(code >> 16));
+                }
+            }
+        }
+
+        return encoded;
+    }
+
+    struct MsAdpcmState
+    {
+        int Coefficients[2]{};
+        int Delta{};
+        int Sample1{}; // most recent
+        int Sample2{};
+    };
+
+    static uint32_t EncodeMsAdpcmNibble(MsAdpcmState& state, int target)
+    {
+        const int prediction = (state.Sample1 * state.Coefficients[0] + state.Sample2 * state.Coefficients[1]) / 256;
+
+        // Rounded to the nearest step
+        const int error = target - prediction;
+        const int code = std::clamp((error + (error < 0 ? -state.Delta : state.Delta) / 2) / state.Delta, -8, 7);
+        const int sample = std::clamp(prediction + code * state.Delta, -32768, 32767);
+
+        const auto nibble = static_cast<uint32_t>(code) & 0xf;
+        state.Sample2 = state.Sample1;
+        state.Sample1 = sample;
+        state.Delta = std::max(16, MsAdpcmAdaption[nibble] * state.Delta / 256);
+        return nibble;
+    }
+
+    // Squared error of a predictor on the clean input, without running the quantizer. Much cheaper than
+    // trial encoding and good enough to rank the predictors by
+    static int64_t GetMsAdpcmPredictionError(const int (&coefficients)[2], const PcmInput& input, uint64_t first, uint32_t channel)
+    {
+        int64_t total{};
+        int sample1 = input.Get(first + 1, channel);
+        int sample2 = input.Get(first, channel);
+        for (uint64_t frame = first + 2; frame < first + MsAdpcmBlockFrames; frame++)
+        {
+            const int target = input.Get(frame, channel);
+            const int64_t error = target - (sample1 * coefficients[0] + sample2 * coefficients[1]) / 256;
+            total += error * error;
+            sample2 = sample1;
+            sample1 = target;
+        }
+        return total;
+    }
+
+    // Squared error of one channel over the first frameCount frames of a block when starting out from state
+    static int64_t GetMsAdpcmBlockError(MsAdpcmState state, const PcmInput& input, uint64_t first, uint32_t channel, uint64_t frameCount)
+    {
+        int64_t total{};
+        for (uint64_t frame = first + 2; frame < first + frameCount; frame++)
+        {
+            const int target = input.Get(frame, channel);
+            EncodeMsAdpcmNibble(state, target);
+            const int64_t error = state.Sample1 - target;
+            total += error * error;
+        }
+        return total;
+    }
+
+    SampleBuffer EncodeMsAdpcm(const int16_t* samples, uint64_t frameCount, uint32_t channels)
+    {
+        assert(channels >= 1 && channels <= MaxChannels);
+
+        const PcmInput input{samples, frameCount, channels};
+        const uint64_t blockCount = (frameCount + MsAdpcmBlockFrames - 1) / MsAdpcmBlockFrames;
+        SampleBuffer encoded(blockCount * GetBlockSize(SampleFormat::MsAdpcm, channels));
+        uint8_t* out = encoded.data();
+
+        for (uint64_t block = 0; block < blockCount; block++)
+        {
+            const uint64_t first = block * MsAdpcmBlockFrames;
+
+            // Every block starts over, so pick whichever predictor and first step size suit it best
+            MsAdpcmState states[MaxChannels]{};
+            int predictors[MaxChannels]{};
+            for (uint32_t channel = 0; channel < channels; channel++)
+            {
+                int64_t bestError = std::numeric_limits<int64_t>::max();
+                for (int predictor = 0; predictor < 7; predictor++)
+                {
+                    const int64_t error = GetMsAdpcmPredictionError(MsAdpcmCoefficients[predictor], input, first, channel);
+                    if (error < bestError)
+                    {
+                        bestError = error;
+                        predictors[channel] = predictor;
+                    }
+                }
+
+                const auto& coefficients = MsAdpcmCoefficients[predictors[channel]];
+                bestError = std::numeric_limits<int64_t>::max();
+                for (const int delta : MsAdpcmInitialDeltas)
+                {
+                    const MsAdpcmState state{{coefficients[0], coefficients[1]}, delta, input.Get(first + 1, channel),
+                                             input.Get(first, channel)};
+
+                    const int64_t error = GetMsAdpcmBlockError(state, input, first, channel, MsAdpcmDeltaTrialFrames);
+                    if (error < bestError)
+                    {
+                        bestError = error;
+                        states[channel] = state;
+                    }
+                }
+            }
+
+            // Header: predictors, step sizes, then the second frame before the first
+            for (uint32_t channel = 0; channel < channels; channel++)
+                *out++ = static_cast<uint8_t>(predictors[channel]);
+            for (uint32_t channel = 0; channel < channels; channel++)
+                Write16(out, states[channel].Delta);
+            for (uint32_t channel = 0; channel < channels; channel++)
+                Write16(out, states[channel].Sample1);
+            for (uint32_t channel = 0; channel < channels; channel++)
+                Write16(out, states[channel].Sample2);
+
+            // Interleaved by channel, two nibbles per byte with the first one in the upper bits
+            bool upper = true;
+            for (uint64_t frame = first + 2; frame < first + MsAdpcmBlockFrames; frame++)
+            {
+                for (uint32_t channel = 0; channel < channels; channel++)
+                {
+                    const uint32_t nibble = EncodeMsAdpcmNibble(states[channel], input.Get(frame, channel));
+                    if (upper)
+                        *out = static_cast<uint8_t>(nibble << 4);
+                    else
+                        *out++ |= static_cast<uint8_t>(nibble);
+                    upper = !upper;
+                }
+            }
+        }
+
+        return encoded;
+    }
+} // namespace Hazel::Audio
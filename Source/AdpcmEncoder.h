@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+
+#include "AudioDecoder.h"
+
+namespace Hazel::Audio
+{
+    // Frames per block, as passed to AL_UNPACK_BLOCK_ALIGNMENT_SOFT. Both come to 512 bytes per channel,
+    // big enough that the block headers cost next to nothing
+    constexpr uint32_t Ima4BlockFrames = 1017;
+    constexpr uint32_t MsAdpcmBlockFrames = 1012;
+
+    // Encode interleaved 16-bit PCM into the block layouts OpenAL Soft decodes. The last
+    // block is padded with silence. Both handle mono and stereo only
+    SampleBuffer EncodeIma4(const int16_t* samples, uint64_t frameCount, uint32_t channels);
+    SampleBuffer EncodeMsAdpcm(const int16_t* samples, uint64_t frameCount, uint32_t channels);
+} // namespace Hazel::Audio
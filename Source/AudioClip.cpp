@@ -0,0 +1,617 @@
+#include "HazelAudio/HazelAudio.h"
+
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "al.h"
+#include "alext.h"
+#include "AudioDecoder.h"
+#include "BufferPool.h"
+#include "ClipLoading.h"
+#include "PcmCache.h"
+#include "ThreadPool.h"
+
+namespace Hazel::Audio
+{
+    // Clips shared between every Source that loaded the same file.
+    // Entries are weak so a clip is freed as soon as its last user goes away
+    static std::mutex s_ClipCacheMutex;
+    static std::unordered_map<std::string, std::weak_ptr<AudioClip>> s_ClipCache;
+
+    struct PendingClipLoad
+    {
+        std::string Filename;
+        std::string CacheKey;
+        SampleFormat Format{};
+        std::promise<std::shared_ptr<AudioClip>> Promise;
+        std::shared_future<std::shared_ptr<AudioClip>> Future;
+        std::vector<ClipLoadCallback> Callbacks;
+
+        DecodedAudio Audio; // filled in by a decode worker
+        bool Decoded{};
+        std::shared_ptr<AudioClip> Clip; // already set for cache hits
+    };
+
+    static std::unique_ptr<ThreadPool> s_DecodePool;
+
+    // Loads that are decoding or waiting for Update to upload them, by cache key
+    static std::mutex s_PendingLoadsMutex;
+    static std::unordered_map<std::string, std::shared_ptr<PendingClipLoad>> s_PendingLoads;
+    static std::vector<std::shared_ptr<PendingClipLoad>> s_CompletedLoads;
+
+    void InitClipLoading(uint32_t decodeThreads)
+    {
+        s_DecodePool = std::make_unique<ThreadPool>(decodeThreads);
+    }
+
+    void ShutdownClipLoading()
+    {
+        // Waits for running decodes, anything still queued is dropped
+        s_DecodePool.reset();
+
+        std::lock_guard lock(s_PendingLoadsMutex);
+        for (auto& [key, load] : s_PendingLoads)
+            load->Promise.set_value(nullptr);
+        s_PendingLoads.clear();
+        s_CompletedLoads.clear();
+    }
+
+    void ProcessCompletedClipLoads()
+    {
+        std::vector<std::shared_ptr<PendingClipLoad>> completed;
+        {
+            std::lock_guard lock(s_PendingLoadsMutex);
+            completed.swap(s_CompletedLoads);
+        }
+
+        for (const auto& load : completed)
+        {
+            const bool cacheHit = load->Clip != nullptr;
+            if (!cacheHit && load->Decoded)
+            {
+                load->Clip = AudioClip::Upload(load->Audio);
+                if (load->Clip)
+                    load->Clip = AudioClip::AddToCache(load->Clip, load->Filename, load->CacheKey);
+            }
+            load->Audio = {};
+
+            std::vector<ClipLoadCallback> callbacks;
+            {
+                std::lock_guard lock(s_PendingLoadsMutex);
+                if (!cacheHit)
+                    s_PendingLoads.erase(load->CacheKey);
+                callbacks.swap(load->Callbacks);
+            }
+
+            if (!cacheHit)
+                load->Promise.set_value(load->Clip);
+            for (const auto& callback : callbacks)
+                callback(load->Clip);
+        }
+    }
+
+    // The same file loaded in another sample format or storage is a separate clip
+    static std::string GetCacheKey(const std::string& filename, SampleFormat sampleFormat = SampleFormat::Int16,
+                                   ClipStorage storage = ClipStorage::Decoded)
+    {
+        std::error_code error;
+        std::string key = std::filesystem::weakly_canonical(filename, error).string();
+        if (error)
+            key = filename;
+        if (sampleFormat != SampleFormat::Int16)
+            key += std::string("|") + GetSampleFormatName(sampleFormat);
+        if (storage == ClipStorage::Compressed)
+            key += "|compressed";
+        return key;
+    }
+
+    static std::shared_ptr<AudioClip> FindCachedClip(const std::string& key)
+    {
+        std::lock_guard lock(s_ClipCacheMutex);
+        const auto it = s_ClipCache.find(key);
+        if (it == s_ClipCache.end())
+            return nullptr;
+        return it->second.lock();
+    }
+
+    std::shared_ptr<AudioClip> AudioClip::Upload(const DecodedAudio& audio)
+    {
+        std::shared_ptr<AudioClip> clip(new AudioClip());
+        clip->mBufferHandle = AcquireBuffer();
+        if (!clip->mBufferHandle)
+            return nullptr;
+
+        // The AL error sticks until read, don't let an earlier failure elsewhere fail this upload
+        alGetError();
+
+        // Frames per ADPCM block, ReleaseBuffer puts it back to the default
+        if (GetBlockFrames(audio.Format) > 1)
+            alBufferi(clip->mBufferHandle, AL_UNPACK_BLOCK_ALIGNMENT_SOFT, static_cast<int>(GetBlockFrames(audio.Format)));
+
+        alBufferData(clip->mBufferHandle, GetOpenAlFormat(audio.Channels, audio.Format), audio.GetData(), static_cast<int>(audio.GetSize()),
+                     static_cast<int>(audio.SampleRate));
+
+        // Loops skip the padding at the end of the last ADPCM block
+        if (audio.PaddingFrames > 0)
+        {
+            const int loopPoints[2] = {0, static_cast<int>(audio.GetFrameCount())};
+            alBufferiv(clip->mBufferHandle, AL_LOOP_POINTS_SOFT, loopPoints);
+        }
+
+        if (alGetError() != AL_NO_ERROR)
+            return nullptr;
+
+        clip->mSampleFormat = audio.Format;
+        clip->mSampleRate = audio.SampleRate;
+        clip->mChannels = audio.Channels;
+        clip->mDuration = static_cast<float>(audio.GetFrameCount()) / static_cast<float>(audio.SampleRate);
+
+        return clip;
+    }
+
+    std::shared_ptr<AudioClip> AudioClip::AddToCache(const std::shared_ptr<AudioClip>& clip, const std::string& filename,
+                                                     const std::string& key)
+    {
+        std::lock_guard lock(s_ClipCacheMutex);
+
+        // Someone else may have loaded the same file in the meantime, keep theirs
+        auto& entry = s_ClipCache[key];
+        if (auto existing = entry.lock())
+            return existing;
+
+        clip->mFormat = GetFileFormat(filename);
+        clip->mFilename = filename;
+        clip->mCacheKey = key;
+        entry = clip;
+        return clip;
+    }
+
+    AudioClip::~AudioClip()
+    {
+        ReleaseBuffer(mBufferHandle);
+
+        std::lock_guard lock(s_ClipCacheMutex);
+        const auto it = s_ClipCache.find(mCacheKey);
+        if (it != s_ClipCache.end() && it->second.expired())
+            s_ClipCache.erase(it);
+    }
+
+    std::shared_ptr<AudioClip> AudioClip::CreateStreamed(std::unique_ptr<AudioDecoder> decoder, SampleFormat sampleFormat)
+    {
+        if (!decoder)
+            return nullptr;
+
+        // Chunks are decoded just before they're played, there's no point in transcoding them
+        if (sampleFormat != SampleFormat::Float32)
+            sampleFormat = SampleFormat::Int16;
+
+        std::shared_ptr<AudioClip> clip(new AudioClip());
+        clip->mStorage = ClipStorage::Streamed;
+        clip->mSampleFormat = sampleFormat;
+        clip->mSampleRate = decoder->GetSampleRate();
+        clip->mChannels = decoder->GetChannels();
+        clip->mDuration = static_cast<float>(decoder->GetTotalFrames()) / static_cast<float>(clip->mSampleRate);
+        clip->mSeekIndex = decoder->GetSeekIndex();
+        return clip;
+    }
+
+    std::shared_ptr<AudioClip> AudioClip::CreateCompressed(std::vector<uint8_t> data, AudioFileFormat format, SampleFormat sampleFormat,
+                                                           std::shared_ptr<const Mp3SeekIndex> seekIndex)
+    {
+        auto clip = CreateStreamed(Audio::OpenDecoder(data.data(), data.size(), format, sampleFormat, std::move(seekIndex)), sampleFormat);
+        if (!clip)
+            return nullptr;
+
+        // Every Source playing it decodes from this copy through its own decoder
+        clip->mStorage = ClipStorage::Compressed;
+        clip->mFormat = format;
+        clip->mCompressedData = std::move(data);
+        clip->mData = clip->mCompressedData.data();
+        clip->mDataSize = clip->mCompressedData.size();
+        return clip;
+    }
+
+    static bool ReadFile(const std::string& filename, std::vector<uint8_t>& data)
+    {
+        std::ifstream file(filename, std::ios::binary | std::ios::ate);
+        if (!file)
+            return false;
+
+        data.resize(static_cast<size_t>(file.tellg()));
+        file.seekg(0);
+        return static_cast<bool>(file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size())));
+    }
+
+    static bool ReadAll(AudioReader& reader, std::vector<uint8_t>& data)
+    {
+        data.resize(reader.GetSize());
+        size_t offset{};
+        while (offset < data.size())
+        {
+            const size_t read = reader.Read(data.data() + offset, data.size() - offset);
+            if (read == 0)
+                return false;
+            offset += read;
+        }
+        return true;
+    }
+
+    std::unique_ptr<AudioDecoder> AudioClip::OpenDecoder() const
+    {
+        if (mOpenReader)
+            return Audio::OpenDecoder(mOpenReader(), mFormat, mSampleFormat, mSeekIndex);
+        if (mData)
+            return Audio::OpenDecoder(mData, mDataSize, mFormat, mSampleFormat, mSeekIndex);
+        return Audio::OpenDecoder(mFilename, mSampleFormat, mSeekIndex);
+    }
+
+    // Only the first load of an MP3 scans it, later runs pick the seek index up from the PCM cache
+    static void StoreSeekIndex(const std::string& filename, const std::shared_ptr<const Mp3SeekIndex>& cached,
+                               const std::shared_ptr<const Mp3SeekIndex>& built)
+    {
+        if (built && built != cached)
+            StoreCachedSeekIndex(filename, *built);
+    }
+
+    std::shared_ptr<AudioClip> AudioClip::LoadFromFile(const std::string& filename, ClipStorage storage, SampleFormat sampleFormat)
+    {
+        if (storage == ClipStorage::Streamed)
+        {
+            // Nothing to share, every Source streams through its own decoder
+            const auto seekIndex = LoadCachedSeekIndex(filename);
+            auto clip = CreateStreamed(Audio::OpenDecoder(filename, sampleFormat, seekIndex), sampleFormat);
+            if (clip)
+            {
+                clip->mFormat = GetFileFormat(filename);
+                clip->mFilename = filename;
+                StoreSeekIndex(filename, seekIndex, clip->mSeekIndex);
+            }
+            return clip;
+        }
+
+        const std::string key = GetCacheKey(filename, sampleFormat, storage);
+        if (auto clip = FindCachedClip(key))
+            return clip;
+
+        if (storage == ClipStorage::Compressed)
+        {
+            std::vector<uint8_t> data;
+            if (!ReadFile(filename, data))
+                return nullptr;
+
+            const auto seekIndex = LoadCachedSeekIndex(filename);
+            auto clip = CreateCompressed(std::move(data), GetFileFormat(filename), sampleFormat, seekIndex);
+            if (!clip)
+                return nullptr;
+
+            StoreSeekIndex(filename, seekIndex, clip->mSeekIndex);
+            return AddToCache(clip, filename, key);
+        }
+
+        // Both formats decode straight into a buffer sized for exactly this file,
+        // which is freed again right after the upload
+        DecodedAudio audio;
+        if (!DecodeFile(filename, sampleFormat, audio))
+            return nullptr;
+
+        auto clip = Upload(audio);
+        if (!clip)
+            return nullptr;
+
+        return AddToCache(clip, filename, key);
+    }
+
+    std::shared_ptr<AudioClip> AudioClip::LoadFromMemory(const void* data, size_t size, AudioFileFormat format, ClipStorage storage,
+                                                         SampleFormat sampleFormat)
+    {
+        if (storage == ClipStorage::Compressed)
+        {
+            const auto* bytes = static_cast<const uint8_t*>(data);
+            return CreateCompressed({bytes, bytes + size}, format, sampleFormat);
+        }
+
+        auto decoder = Audio::OpenDecoder(data, size, format, sampleFormat);
+        if (!decoder)
+            return nullptr;
+
+        if (storage == ClipStorage::Streamed)
+        {
+            auto clip = CreateStreamed(std::move(decoder), sampleFormat);
+            clip->mFormat = format;
+            clip->mData = data;
+            clip->mDataSize = size;
+            return clip;
+        }
+
+        DecodedAudio audio;
+        if (!DecodeAll(*decoder, sampleFormat, audio))
+            return nullptr;
+
+        auto clip = Upload(audio);
+        if (clip)
+            clip->mFormat = format;
+        return clip;
+    }
+
+    std::shared_ptr<AudioClip> AudioClip::LoadFromReader(AudioReaderFactory openReader, AudioFileFormat format, ClipStorage storage,
+                                                         SampleFormat sampleFormat)
+    {
+        if (!openReader)
+            return nullptr;
+
+        if (storage == ClipStorage::Compressed)
+        {
+            // The reader is only needed until everything is in memory
+            const auto reader = openReader();
+            std::vector<uint8_t> data;
+            if (!reader || !ReadAll(*reader, data))
+                return nullptr;
+
+            return CreateCompressed(std::move(data), format, sampleFormat);
+        }
+
+        auto decoder = Audio::OpenDecoder(openReader(), format, sampleFormat);
+        if (!decoder)
+            return nullptr;
+
+        if (storage == ClipStorage::Streamed)
+        {
+            auto clip = CreateStreamed(std::move(decoder), sampleFormat);
+            clip->mFormat = format;
+            clip->mOpenReader = std::move(openReader);
+            return clip;
+        }
+
+        DecodedAudio audio;
+        if (!DecodeAll(*decoder, sampleFormat, audio))
+            return nullptr;
+
+        auto clip = Upload(audio);
+        if (clip)
+            clip->mFormat = format;
+        return clip;
+    }
+
+    std::shared_future<std::shared_ptr<AudioClip>> AudioClip::LoadFromFileAsync(const std::string& filename, ClipLoadCallback callback,
+                                                                                 SampleFormat sampleFormat)
+    {
+        // Before Init or after Shutdown there's no pool to decode on and no Update to finish the load
+        if (!s_DecodePool)
+        {
+            std::promise<std::shared_ptr<AudioClip>> promise;
+            promise.set_value(nullptr);
+            return promise.get_future().share();
+        }
+
+        auto load = std::make_shared<PendingClipLoad>();
+        load->Filename = filename;
+        load->CacheKey = GetCacheKey(filename, sampleFormat);
+        load->Format = sampleFormat;
+        load->Future = load->Promise.get_future().share();
+        if (callback)
+            load->Callbacks.push_back(std::move(callback));
+
+        if (auto clip = FindCachedClip(load->CacheKey))
+        {
+            // Still goes through Update so the callback always runs on the same thread
+            load->Clip = clip;
+            load->Promise.set_value(clip);
+
+            std::lock_guard lock(s_PendingLoadsMutex);
+            s_CompletedLoads.push_back(load);
+            return load->Future;
+        }
+
+        {
+            std::lock_guard lock(s_PendingLoadsMutex);
+            auto& pending = s_PendingLoads[load->CacheKey];
+            if (pending)
+            {
+                // Already decoding, piggyback on that load
+                if (!load->Callbacks.empty())
+                    pending->Callbacks.push_back(std::move(load->Callbacks.front()));
+                return pending->Future;
+            }
+            pending = load;
+        }
+
+        s_DecodePool->Enqueue([load]
+        {
+            load->Decoded = DecodeFile(load->Filename, load->Format, load->Audio);
+
+            std::lock_guard lock(s_PendingLoadsMutex);
+            s_CompletedLoads.push_back(load);
+        });
+
+        return load->Future;
+    }
+
+    PreloadResult PreloadClips(const std::vector<std::string>& filenames, const PreloadProgressCallback& progress)
+    {
+        PreloadResult result;
+        result.Clips.resize(filenames.size());
+
+        if (!s_DecodePool)
+        {
+            for (const auto& filename : filenames)
+                result.Errors.push_back({filename, "Audio isn't initialized"});
+            return result;
+        }
+
+        struct BatchLoad
+        {
+            std::string CacheKey;
+            std::vector<size_t> Indices; // positions in the input, duplicates share a single decode
+            DecodedAudio Audio;
+            bool Decoded{};
+        };
+
+        std::vector<BatchLoad> loads;
+        std::unordered_map<std::string, size_t> loadsByKey;
+
+        const size_t total = filenames.size();
+        size_t completed{};
+
+        auto addError = [&](const std::string& filename, const char* message)
+        {
+            result.Errors.push_back({filename, message});
+        };
+
+        for (size_t i = 0; i < total; i++)
+        {
+            const auto& filename = filenames[i];
+            const std::string key = GetCacheKey(filename);
+
+            if (auto clip = FindCachedClip(key))
+            {
+                result.Clips[i] = std::move(clip);
+                completed++;
+                continue;
+            }
+
+            if (GetFileFormat(filename) == AudioFileFormat::None)
+            {
+                addError(filename, "Unsupported file format");
+                completed++;
+                continue;
+            }
+
+            if (std::error_code error; !std::filesystem::exists(filename, error))
+            {
+                addError(filename, "File not found");
+                completed++;
+                continue;
+            }
+
+            const auto [it, inserted] = loadsByKey.try_emplace(key, loads.size());
+            if (inserted)
+                loads.push_back({key, {}, {}, false});
+            loads[it->second].Indices.push_back(i);
+        }
+
+        if (progress)
+            progress(completed, total);
+
+        // Workers only decode and report back, uploads happen here on the context thread
+        std::mutex mutex;
+        std::condition_variable condition;
+        std::vector<size_t> decoded;
+
+        for (size_t i = 0; i < loads.size(); i++)
+        {
+            s_DecodePool->Enqueue([&, i]
+            {
+                auto& load = loads[i];
+                load.Decoded = DecodeFile(filenames[load.Indices.front()], SampleFormat::Int16, load.Audio);
+
+                std::lock_guard lock(mutex);
+                decoded.push_back(i);
+                condition.notify_one();
+            });
+        }
+
+        for (size_t uploaded = 0; uploaded < loads.size();)
+        {
+            std::vector<size_t> ready;
+            {
+                std::unique_lock lock(mutex);
+                condition.wait(lock, [&] { return !decoded.empty(); });
+                ready.swap(decoded);
+            }
+
+            for (const size_t index : ready)
+            {
+                auto& load = loads[index];
+                const auto& filename = filenames[load.Indices.front()];
+
+                std::shared_ptr<AudioClip> clip;
+                if (!load.Decoded)
+                    addError(filename, "Failed to decode");
+                else if (!(clip = AudioClip::Upload(load.Audio)))
+                    addError(filename, "Failed to upload to OpenAL");
+                else
+                    clip = AudioClip::AddToCache(clip, filename, load.CacheKey);
+                load.Audio = {};
+
+                for (const size_t i : load.Indices)
+                    result.Clips[i] = clip;
+
+                completed += load.Indices.size();
+                uploaded++;
+            }
+
+            if (progress)
+                progress(completed, total);
+        }
+
+        return result;
+    }
+
+    PreloadResult PreloadManifest(const std::string& manifestFilename, const PreloadProgressCallback& progress)
+    {
+        std::ifstream manifest(manifestFilename);
+        if (!manifest)
+        {
+            PreloadResult result;
+            result.Errors.push_back({manifestFilename, "Failed to open manifest"});
+            return result;
+        }
+
+        const std::filesystem::path directory = std::filesystem::path(manifestFilename).parent_path();
+
+        std::vector<std::string> filenames;
+        std::string line;
+        while (std::getline(manifest, line))
+        {
+            const auto begin = line.find_first_not_of(" \t\r");
+            if (begin == std::string::npos || line[begin] == '#')
+                continue;
+            const auto end = line.find_last_not_of(" \t\r");
+
+            filenames.push_back((directory / line.substr(begin, end - begin + 1)).string());
+        }
+
+        return PreloadClips(filenames, progress);
+    }
+
+    ClipStorage AudioClip::GetStorage() const
+    {
+        return mStorage;
+    }
+
+    SampleFormat AudioClip::GetSampleFormat() const
+    {
+        return mSampleFormat;
+    }
+
+    const std::string& AudioClip::GetFilename() const
+    {
+        return mFilename;
+    }
+
+    float AudioClip::GetDuration() const
+    {
+        return mDuration;
+    }
+
+    uint32_t AudioClip::GetSampleRate() const
+    {
+        return mSampleRate;
+    }
+
+    uint32_t AudioClip::GetChannels() const
+    {
+        return mChannels;
+    }
+
+    uint32_t AudioClip::GetBufferHandle() const
+    {
+        return mBufferHandle;
+    }
+} // namespace Hazel::Audio
@@ -0,0 +1,691 @@
+#include "AudioDecoder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <climits>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iterator>
+#include <type_traits>
+
+#include "AdpcmEncoder.h"
+#include "alext.h"
+#include "MappedFile.h"
+#include "PcmCache.h"
+
+// Decodes straight to 16-bit, which is what most clips are stored as
+#define MINIMP3_IMPLEMENTATION
+#include "minimp3.h"
+#include "minimp3_ex.h"
+
+// Float32 clips get a second copy of minimp3 built with float output, so they aren't quantized on the way.
+// The namespace keeps its types apart, its functions have C linkage though and need names of their own
+#define mp3dec_init mp3float_init
+#define mp3dec_decode_frame mp3float_decode_frame
+#define mp3dec_f32_to_s16 mp3float_f32_to_s16
+#define mp3dec_detect_buf mp3float_detect_buf
+#define mp3dec_detect_cb mp3float_detect_cb
+#define mp3dec_load_buf mp3float_load_buf
+#define mp3dec_load_cb mp3float_load_cb
+#define mp3dec_iterate_buf mp3float_iterate_buf
+#define mp3dec_iterate_cb mp3float_iterate_cb
+#define mp3dec_ex_open_buf mp3float_ex_open_buf
+#define mp3dec_ex_open_cb mp3float_ex_open_cb
+#define mp3dec_ex_close mp3float_ex_close
+#define mp3dec_ex_seek mp3float_ex_seek
+#define mp3dec_ex_read mp3float_ex_read
+#define mp3dec_detect mp3float_detect
+#define mp3dec_load mp3float_load
+#define mp3dec_iterate mp3float_iterate
+#define mp3dec_ex_open mp3float_ex_open
+#define mp3dec_detect_w mp3float_detect_w
+#define mp3dec_load_w mp3float_load_w
+#define mp3dec_iterate_w mp3float_iterate_w
+#define mp3dec_ex_open_w mp3float_ex_open_w
+#undef MINIMP3_H
+#undef MINIMP3_EXT_H
+#undef _MINIMP3_IMPLEMENTATION_GUARD
+#define MINIMP3_FLOAT_OUTPUT
+namespace Mp3Float
+{
+#include "minimp3.h"
+#include "minimp3_ex.h"
+} // namespace Mp3Float
+#undef mp3dec_init
+#undef mp3dec_decode_frame
+#undef mp3dec_f32_to_s16
+#undef mp3dec_detect_buf
+#undef mp3dec_detect_cb
+#undef mp3dec_load_buf
+#undef mp3dec_load_cb
+#undef mp3dec_iterate_buf
+#undef mp3dec_iterate_cb
+#undef mp3dec_ex_open_buf
+#undef mp3dec_ex_open_cb
+#undef mp3dec_ex_close
+#undef mp3dec_ex_seek
+#undef mp3dec_ex_read
+#undef mp3dec_detect
+#undef mp3dec_load
+#undef mp3dec_iterate
+#undef mp3dec_ex_open
+#undef mp3dec_detect_w
+#undef mp3dec_load_w
+#undef mp3dec_iterate_w
+#undef mp3dec_ex_open_w
+
+#include "vorbis/codec.h"
+#include "vorbis/vorbisfile.h"
+
+namespace Hazel::Audio
+{
+    static std::atomic<size_t> s_DecodeMemory;
+    static std::atomic<size_t> s_PeakDecodeMemory;
+
+    void TrackDecodeMemory(ptrdiff_t bytes)
+    {
+        const size_t current = s_DecodeMemory.fetch_add(static_cast<size_t>(bytes)) + static_cast<size_t>(bytes);
+
+        size_t peak = s_PeakDecodeMemory.load();
+        while (current > peak && !s_PeakDecodeMemory.compare_exchange_weak(peak, current))
+        {
+        }
+    }
+
+    MemoryStats GetMemoryStats()
+    {
+        return {s_DecodeMemory.load(), s_PeakDecodeMemory.load()};
+    }
+
+    AudioFileFormat GetFileFormat(const std::string& filename)
+    {
+        const std::filesystem::path path = filename;
+        const std::string extension = path.extension().string();
+
+        if (extension == ".ogg")
+            return AudioFileFormat::Ogg;
+        if (extension == ".mp3")
+            return AudioFileFormat::MP3;
+
+        return AudioFileFormat::None;
+    }
+
+    ALenum GetOpenAlFormat(uint32_t channels, SampleFormat format)
+    {
+        assert(channels == 1 || channels == 2);
+        const bool mono = channels == 1;
+
+        switch (format)
+        {
+        case SampleFormat::Int16: return mono ? AL_FORMAT_MONO16 : AL_FORMAT_STEREO16;
+        case SampleFormat::Float32: return mono ? AL_FORMAT_MONO_FLOAT32 : AL_FORMAT_STEREO_FLOAT32;
+        case SampleFormat::Ima4: return mono ? AL_FORMAT_MONO_IMA4 : AL_FORMAT_STEREO_IMA4;
+        case SampleFormat::MsAdpcm: return mono ? AL_FORMAT_MONO_MSADPCM_SOFT : AL_FORMAT_STEREO_MSADPCM_SOFT;
+        }
+
+        return AL_NONE;
+    }
+
+    uint32_t GetBlockFrames(SampleFormat format)
+    {
+        switch (format)
+        {
+        case SampleFormat::Ima4: return Ima4BlockFrames;
+        case SampleFormat::MsAdpcm: return MsAdpcmBlockFrames;
+        default: return 1;
+        }
+    }
+
+    size_t GetBlockSize(SampleFormat format, uint32_t channels)
+    {
+        // Per channel, the ADPCM sizes are a header plus 4 bits for every frame it doesn't cover
+        switch (format)
+        {
+        case SampleFormat::Int16: return channels * sizeof(int16_t);
+        case SampleFormat::Float32: return channels * sizeof(float);
+        case SampleFormat::Ima4: return channels * ((Ima4BlockFrames - 1) / 2 + 4);
+        case SampleFormat::MsAdpcm: return channels * ((MsAdpcmBlockFrames - 2) / 2 + 7);
+        }
+
+        return 0;
+    }
+
+    const char* GetSampleFormatName(SampleFormat format)
+    {
+        switch (format)
+        {
+        case SampleFormat::Int16: return "i16";
+        case SampleFormat::Float32: return "f32";
+        case SampleFormat::Ima4: return "ima4";
+        case SampleFormat::MsAdpcm: return "msadpcm";
+        }
+
+        return "";
+    }
+
+    // ov_callbacks over a region of memory, so Vorbis pages are read straight
+    // out of a mapped file instead of going through stdio
+    struct MemoryReader
+    {
+        const uint8_t* Data{};
+        size_t Size{};
+        size_t Position{};
+
+        static size_t Read(void* out, size_t size, size_t count, void* source)
+        {
+            auto* reader = static_cast<MemoryReader*>(source);
+            if (size == 0)
+                return 0;
+
+            count = std::min(count, (reader->Size - reader->Position) / size);
+            memcpy(out, reader->Data + reader->Position, count * size);
+            reader->Position += count * size;
+            return count;
+        }
+
+        static int Seek(void* source, ogg_int64_t offset, int whence)
+        {
+            auto* reader = static_cast<MemoryReader*>(source);
+
+            ogg_int64_t position;
+            switch (whence)
+            {
+            case SEEK_SET: position = offset; break;
+            case SEEK_CUR: position = static_cast<ogg_int64_t>(reader->Position) + offset; break;
+            case SEEK_END: position = static_cast<ogg_int64_t>(reader->Size) + offset; break;
+            default: return -1;
+            }
+
+            if (position < 0 || position > static_cast<ogg_int64_t>(reader->Size))
+                return -1;
+
+            reader->Position = static_cast<size_t>(position);
+            return 0;
+        }
+
+        static long Tell(void* source)
+        {
+            return static_cast<long>(static_cast<MemoryReader*>(source)->Position);
+        }
+
+        static constexpr ov_callbacks Callbacks{Read, Seek, nullptr, Tell};
+    };
+
+    // Adapts a user supplied AudioReader to ov_callbacks
+    struct ReaderCallbacks
+    {
+        static size_t Read(void* out, size_t size, size_t count, void* source)
+        {
+            if (size == 0)
+                return 0;
+            return static_cast<AudioReader*>(source)->Read(out, size * count) / size;
+        }
+
+        static int Seek(void* source, ogg_int64_t offset, int whence)
+        {
+            auto* reader = static_cast<AudioReader*>(source);
+
+            ogg_int64_t position;
+            switch (whence)
+            {
+            case SEEK_SET: position = offset; break;
+            case SEEK_CUR: position = static_cast<ogg_int64_t>(reader->Tell()) + offset; break;
+            case SEEK_END: position = static_cast<ogg_int64_t>(reader->GetSize()) + offset; break;
+            default: return -1;
+            }
+
+            if (position < 0)
+                return -1;
+            return reader->Seek(static_cast<uint64_t>(position)) ? 0 : -1;
+        }
+
+        static long Tell(void* source)
+        {
+            return static_cast<long>(static_cast<AudioReader*>(source)->Tell());
+        }
+
+        static constexpr ov_callbacks Callbacks{Read, Seek, nullptr, Tell};
+    };
+
+    class OggDecoder final : public AudioDecoder
+    {
+    public:
+        ~OggDecoder() override
+        {
+            if (mOpen)
+                ov_clear(&mFile);
+        }
+
+        bool OpenFile(const std::string& filename)
+        {
+            if (!mMappedFile.Open(filename))
+                return false;
+
+            return OpenMemory(mMappedFile.GetData(), mMappedFile.GetSize());
+        }
+
+        bool OpenMemory(const void* data, size_t size)
+        {
+            mMemoryReader = {static_cast<const uint8_t*>(data), size, 0};
+            return Open(&mMemoryReader, MemoryReader::Callbacks);
+        }
+
+        bool OpenReader(std::unique_ptr<AudioReader> reader)
+        {
+            mReader = std::move(reader);
+            return Open(mReader.get(), ReaderCallbacks::Callbacks);
+        }
+
+        size_t Read(int16_t* out, size_t frameCount) override
+        {
+            const size_t frameSize = mChannels * sizeof(int16_t);
+            auto* bufferPtr = reinterpret_cast<char*>(out);
+            size_t bytesLeft = frameCount * frameSize;
+            while (bytesLeft > 0)
+            {
+                // ov_read takes an int, so big requests go in INT_MAX sized pieces
+                int currentSection{};
+                const int chunk = static_cast<int>(std::min<size_t>(bytesLeft, INT_MAX));
+                const auto length = ov_read(&mFile, bufferPtr, chunk, 0, 2, 1, &currentSection);
+                if (length == OV_HOLE)
+                    continue;
+                if (length <= 0)
+                    break;
+
+                bufferPtr += length;
+                bytesLeft -= static_cast<size_t>(length);
+            }
+
+            return frameCount - bytesLeft / frameSize;
+        }
+
+        size_t Read(float* out, size_t frameCount) override
+        {
+            // Straight from the synthesis output, ov_read would have quantized these to 16 bits
+            size_t framesRead{};
+            while (framesRead < frameCount)
+            {
+                float** channels{};
+                int currentSection{};
+                const int chunk = static_cast<int>(std::min<size_t>(frameCount - framesRead, INT_MAX));
+                const long frames = ov_read_float(&mFile, &channels, chunk, &currentSection);
+                if (frames == OV_HOLE)
+                    continue;
+                if (frames <= 0)
+                    break;
+
+                for (long frame = 0; frame < frames; frame++)
+                {
+                    for (uint32_t channel = 0; channel < mChannels; channel++)
+                        *out++ = channels[channel][frame];
+                }
+                framesRead += static_cast<size_t>(frames);
+            }
+
+            return framesRead;
+        }
+
+        bool Seek(uint64_t frame) override
+        {
+            return ov_pcm_seek(&mFile, static_cast<ogg_int64_t>(frame)) == 0;
+        }
+
+    private:
+        bool Open(void* source, const ov_callbacks& callbacks)
+        {
+            if (ov_open_callbacks(source, &mFile, nullptr, 0, callbacks) < 0)
+                return false;
+            mOpen = true;
+
+            const vorbis_info* vi = ov_info(&mFile, -1);
+            mSampleRate = static_cast<uint32_t>(vi->rate);
+            mChannels = static_cast<uint32_t>(vi->channels);
+            mTotalFrames = static_cast<uint64_t>(ov_pcm_total(&mFile, -1));
+            return true;
+        }
+
+        MappedFile mMappedFile;
+        MemoryReader mMemoryReader;
+        std::unique_ptr<AudioReader> mReader;
+        OggVorbis_File mFile{};
+        bool mOpen{};
+    };
+
+    static_assert(sizeof(Mp3SeekIndex::Frame) == sizeof(mp3dec_frame_t) && offsetof(Mp3SeekIndex::Frame, Sample) == offsetof(mp3dec_frame_t, sample) &&
+                      offsetof(Mp3SeekIndex::Frame, Offset) == offsetof(mp3dec_frame_t, offset),
+                  "Mp3SeekIndex frames are handed to minimp3 as they are");
+
+    // The parts of the two minimp3 copies Mp3Decoder needs, by the sample type they decode to
+    template<typename Sample>
+    struct Mp3Api;
+
+    template<>
+    struct Mp3Api<int16_t>
+    {
+        using Decoder = mp3dec_ex_t;
+        using Io = mp3dec_io_t;
+        using Frame = mp3dec_frame_t;
+        static constexpr auto Open = mp3dec_ex_open;
+        static constexpr auto OpenBuffer = mp3dec_ex_open_buf;
+        static constexpr auto OpenCallbacks = mp3dec_ex_open_cb;
+        static constexpr auto Read = mp3dec_ex_read;
+        static constexpr auto Seek = mp3dec_ex_seek;
+        static constexpr auto Close = mp3dec_ex_close;
+    };
+
+    template<>
+    struct Mp3Api<float>
+    {
+        using Decoder = Mp3Float::mp3dec_ex_t;
+        using Io = Mp3Float::mp3dec_io_t;
+        using Frame = Mp3Float::mp3dec_frame_t;
+        static constexpr auto Open = Mp3Float::mp3float_ex_open;
+        static constexpr auto OpenBuffer = Mp3Float::mp3float_ex_open_buf;
+        static constexpr auto OpenCallbacks = Mp3Float::mp3float_ex_open_cb;
+        static constexpr auto Read = Mp3Float::mp3float_ex_read;
+        static constexpr auto Seek = Mp3Float::mp3float_ex_seek;
+        static constexpr auto Close = Mp3Float::mp3float_ex_close;
+    };
+
+    // Decodes natively to Sample, reading the other type converts through a chunk on the stack
+    template<typename Sample>
+    class Mp3Decoder final : public AudioDecoder
+    {
+        using Api = Mp3Api<Sample>;
+
+    public:
+        ~Mp3Decoder() override
+        {
+            // The index is borrowed from mSeekIndex, closing would free it
+            if (mSeekIndex)
+                mDecoder->index = {};
+            if (mOpen)
+                Api::Close(mDecoder.get());
+        }
+
+        // Has to be set before opening
+        void SetSeekIndex(std::shared_ptr<const Mp3SeekIndex> seekIndex)
+        {
+            if (seekIndex && !seekIndex->Frames.empty())
+                mSeekIndex = std::move(seekIndex);
+        }
+
+        bool OpenFile(const std::string& filename)
+        {
+            // minimp3 already maps the file itself where it can
+            return Open(Api::Open(mDecoder.get(), filename.c_str(), GetOpenFlags()));
+        }
+
+        bool OpenMemory(const void* data, size_t size)
+        {
+            return Open(Api::OpenBuffer(mDecoder.get(), static_cast<const uint8_t*>(data), size, GetOpenFlags()));
+        }
+
+        bool OpenReader(std::unique_ptr<AudioReader> reader)
+        {
+            mReader = std::move(reader);
+            mIo.read = [](void* buffer, size_t size, void* user) { return static_cast<AudioReader*>(user)->Read(buffer, size); };
+            mIo.read_data = mReader.get();
+            mIo.seek = [](uint64_t position, void* user) { return static_cast<AudioReader*>(user)->Seek(position) ? 0 : -1; };
+            mIo.seek_data = mReader.get();
+            return Open(Api::OpenCallbacks(mDecoder.get(), &mIo, GetOpenFlags()));
+        }
+
+        size_t Read(int16_t* out, size_t frameCount) override
+        {
+            if constexpr (std::is_same_v<Sample, int16_t>)
+                return Api::Read(mDecoder.get(), out, frameCount * mChannels) / mChannels;
+            else
+                return ReadConverted(out, frameCount, [](const float* in, int16_t* out, size_t count)
+                                     { Mp3Float::mp3float_f32_to_s16(in, out, static_cast<int>(count)); });
+        }
+
+        size_t Read(float* out, size_t frameCount) override
+        {
+            if constexpr (std::is_same_v<Sample, float>)
+                return Api::Read(mDecoder.get(), out, frameCount * mChannels) / mChannels;
+            else
+                return ReadConverted(out, frameCount, [](const int16_t* in, float* out, size_t count)
+                                     { std::transform(in, in + count, out, [](int16_t sample) { return sample / 32768.0f; }); });
+        }
+
+        bool Seek(uint64_t frame) override
+        {
+            return Api::Seek(mDecoder.get(), frame * mChannels) == 0;
+        }
+
+        std::shared_ptr<const Mp3SeekIndex> GetSeekIndex() override
+        {
+            if (mSeekIndex)
+                return mSeekIndex;
+
+            // With a VBR tag the duration came from the tag, and minimp3 only scans once something seeks
+            if (!mDecoder->index.frames && mDecoder->vbr_tag_found)
+            {
+                Api::Seek(mDecoder.get(), mChannels);
+                Api::Seek(mDecoder.get(), 0);
+            }
+            if (!mDecoder->index.frames || mDecoder->index.num_frames == 0)
+                return nullptr;
+
+            auto index = std::make_shared<Mp3SeekIndex>();
+            const auto* frames = reinterpret_cast<const Mp3SeekIndex::Frame*>(mDecoder->index.frames);
+            index->Frames.assign(frames, frames + mDecoder->index.num_frames);
+            index->Samples = mDecoder->samples;
+
+            // From now on this decoder borrows the shared copy as well
+            free(mDecoder->index.frames);
+            mSeekIndex = index;
+            BorrowSeekIndex();
+            return index;
+        }
+
+    private:
+        template<typename Out, typename Convert>
+        size_t ReadConverted(Out* out, size_t frameCount, Convert&& convert)
+        {
+            Sample chunk[4096];
+            const size_t chunkFrames = std::size(chunk) / mChannels;
+
+            size_t framesRead{};
+            while (framesRead < frameCount)
+            {
+                const size_t frames = Read(chunk, std::min(chunkFrames, frameCount - framesRead));
+                if (frames == 0)
+                    break;
+
+                convert(chunk, out + framesRead * mChannels, frames * mChannels);
+                framesRead += frames;
+            }
+
+            return framesRead;
+        }
+
+        [[nodiscard]] int GetOpenFlags() const
+        {
+            // With an index there's nothing left to scan the file for
+            return mSeekIndex ? MP3D_SEEK_TO_SAMPLE | MP3D_DO_NOT_SCAN : MP3D_SEEK_TO_SAMPLE;
+        }
+
+        void BorrowSeekIndex()
+        {
+            // minimp3 never writes to an index once it has one
+            using Frame = typename Api::Frame;
+            mDecoder->index.frames = const_cast<Frame*>(reinterpret_cast<const Frame*>(mSeekIndex->Frames.data()));
+            mDecoder->index.num_frames = mSeekIndex->Frames.size();
+            mDecoder->index.capacity = mSeekIndex->Frames.size();
+            mDecoder->samples = mSeekIndex->Samples;
+        }
+
+        bool Open(int result)
+        {
+            if (result != 0)
+            {
+                mSeekIndex.reset();
+                return false;
+            }
+            mOpen = true;
+
+            if (mSeekIndex)
+                BorrowSeekIndex();
+
+            if (mDecoder->info.channels <= 0 || mDecoder->samples == 0)
+                return false;
+
+            mSampleRate = static_cast<uint32_t>(mDecoder->info.hz);
+            mChannels = static_cast<uint32_t>(mDecoder->info.channels);
+            mTotalFrames = mDecoder->samples / mChannels;
+            return true;
+        }
+
+        // The decoder carries a full frame of samples, too big to keep inline
+        std::unique_ptr<typename Api::Decoder> mDecoder = std::make_unique<typename Api::Decoder>();
+        std::unique_ptr<AudioReader> mReader;
+        typename Api::Io mIo{}; // minimp3 keeps a pointer to this
+        std::shared_ptr<const Mp3SeekIndex> mSeekIndex;
+        bool mOpen{};
+    };
+
+    template<typename Sample, typename OpenFunc>
+    static std::unique_ptr<AudioDecoder> CreateMp3Decoder(std::shared_ptr<const Mp3SeekIndex> seekIndex, OpenFunc& open)
+    {
+        auto decoder = std::make_unique<Mp3Decoder<Sample>>();
+        decoder->SetSeekIndex(std::move(seekIndex));
+        if (open(*decoder))
+            return decoder;
+        return nullptr;
+    }
+
+    template<typename OpenFunc>
+    static std::unique_ptr<AudioDecoder> CreateDecoder(AudioFileFormat format, SampleFormat sampleFormat,
+                                                       std::shared_ptr<const Mp3SeekIndex> seekIndex, OpenFunc&& open)
+    {
+        switch (format)
+        {
+        case AudioFileFormat::Ogg:
+        {
+            auto decoder = std::make_unique<OggDecoder>();
+            if (open(*decoder))
+                return decoder;
+            break;
+        }
+        case AudioFileFormat::MP3:
+            // Everything but Float32 is read as 16-bit
+            if (sampleFormat == SampleFormat::Float32)
+                return CreateMp3Decoder<float>(std::move(seekIndex), open);
+            return CreateMp3Decoder<int16_t>(std::move(seekIndex), open);
+        case AudioFileFormat::None: break;
+        }
+
+        return nullptr;
+    }
+
+    size_t AudioDecoder::Read(void* out, size_t frameCount, SampleFormat format)
+    {
+        if (format == SampleFormat::Float32)
+            return Read(static_cast<float*>(out), frameCount);
+        return Read(static_cast<int16_t*>(out), frameCount);
+    }
+
+    std::unique_ptr<AudioDecoder> OpenDecoder(const std::string& filename, SampleFormat sampleFormat,
+                                              std::shared_ptr<const Mp3SeekIndex> seekIndex)
+    {
+        return CreateDecoder(GetFileFormat(filename), sampleFormat, std::move(seekIndex),
+                             [&](auto& decoder) { return decoder.OpenFile(filename); });
+    }
+
+    std::unique_ptr<AudioDecoder> OpenDecoder(const void* data, size_t size, AudioFileFormat format, SampleFormat sampleFormat,
+                                              std::shared_ptr<const Mp3SeekIndex> seekIndex)
+    {
+        return CreateDecoder(format, sampleFormat, std::move(seekIndex), [&](auto& decoder) { return decoder.OpenMemory(data, size); });
+    }
+
+    std::unique_ptr<AudioDecoder> OpenDecoder(std::unique_ptr<AudioReader> reader, AudioFileFormat format, SampleFormat sampleFormat,
+                                              std::shared_ptr<const Mp3SeekIndex> seekIndex)
+    {
+        if (!reader)
+            return nullptr;
+        return CreateDecoder(format, sampleFormat, std::move(seekIndex),
+                             [&](auto& decoder) { return decoder.OpenReader(std::move(reader)); });
+    }
+
+    DecodedAudio::DecodedAudio() = default;
+    DecodedAudio::DecodedAudio(DecodedAudio&&) noexcept = default;
+    DecodedAudio& DecodedAudio::operator=(DecodedAudio&&) noexcept = default;
+    DecodedAudio::~DecodedAudio() = default;
+
+    const void* DecodedAudio::GetData() const
+    {
+        if (CachedFile)
+            return CachedFile->GetData() + CachedOffset;
+        return Samples.data();
+    }
+
+    size_t DecodedAudio::GetSize() const
+    {
+        if (CachedFile)
+            return CachedFile->GetSize() - CachedOffset;
+        return Samples.size();
+    }
+
+    uint64_t DecodedAudio::GetFrameCount() const
+    {
+        if (Channels == 0)
+            return 0;
+        return GetSize() / GetBlockSize(Format, Channels) * GetBlockFrames(Format) - PaddingFrames;
+    }
+
+    bool DecodeFile(const std::string& filename, SampleFormat format, DecodedAudio& audio)
+    {
+        if (LoadCachedPcm(filename, format, audio))
+            return true;
+
+        const auto decoder = OpenDecoder(filename, format);
+        if (!decoder || !DecodeAll(*decoder, format, audio))
+            return false;
+
+        StoreCachedPcm(filename, audio);
+        return true;
+    }
+
+    bool DecodeAll(AudioDecoder& decoder, SampleFormat format, DecodedAudio& audio)
+    {
+        if (format == SampleFormat::Ima4 || format == SampleFormat::MsAdpcm)
+        {
+            // Transcoded from 16-bit, which is only held until it's encoded
+            DecodedAudio pcm;
+            if (!DecodeAll(decoder, SampleFormat::Int16, pcm) || pcm.Channels > 2)
+                return false;
+
+            const auto* samples = reinterpret_cast<const int16_t*>(pcm.Samples.data());
+            const uint64_t frameCount = pcm.GetFrameCount();
+            audio.Samples = format == SampleFormat::Ima4 ? EncodeIma4(samples, frameCount, pcm.Channels)
+                                                         : EncodeMsAdpcm(samples, frameCount, pcm.Channels);
+            audio.SampleRate = pcm.SampleRate;
+            audio.Channels = pcm.Channels;
+            audio.Format = format;
+            audio.PaddingFrames = static_cast<uint32_t>(audio.GetFrameCount() - frameCount);
+            return true;
+        }
+
+        const uint64_t totalFrames = decoder.GetTotalFrames();
+        audio.SampleRate = decoder.GetSampleRate();
+        audio.Channels = decoder.GetChannels();
+        audio.Format = format;
+
+        const size_t frameSize = GetBlockSize(format, audio.Channels);
+        audio.Samples.resize(totalFrames * frameSize);
+
+        const size_t framesRead = decoder.Read(audio.Samples.data(), totalFrames, format);
+        if (framesRead == 0)
+            return false;
+
+        // Only shrinks if the stream turned out shorter than its header claimed
+        audio.Samples.resize(framesRead * frameSize);
+        return true;
+    }
+} // namespace Hazel::Audio
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "HazelAudio/HazelAudio.h"
+#include "al.h"
+
+namespace Hazel::Audio
+{
+    AudioFileFormat GetFileFormat(const std::string& filename);
+    ALenum GetOpenAlFormat(uint32_t channels, SampleFormat format);
+    // Samples are stored in blocks of this many frames, 1 for plain PCM
+    uint32_t GetBlockFrames(SampleFormat format);
+    size_t GetBlockSize(SampleFormat format, uint32_t channels); // in bytes
+    // Short name used to tell cache entries of different formats apart
+    const char* GetSampleFormatName(SampleFormat format);
+
+    // Adds to or removes from the decode memory reported by GetMemoryStats
+    void TrackDecodeMemory(ptrdiff_t bytes);
+
+    // Allocator for PCM that is held outside of OpenAL, so decode memory can be reported
+    template<typename T>
+    struct DecodeAllocator
+    {
+        using value_type = T;
+
+        DecodeAllocator() = default;
+        template<typename U>
+        DecodeAllocator(const DecodeAllocator<U>&) noexcept
+        {
+        }
+
+        T* allocate(size_t count)
+        {
+            T* data = std::allocator<T>().allocate(count);
+            TrackDecodeMemory(static_cast<ptrdiff_t>(count * sizeof(T)));
+            return data;
+        }
+
+        void deallocate(T* data, size_t count) noexcept
+        {
+            TrackDecodeMemory(-static_cast<ptrdiff_t>(count * sizeof(T)));
+            std::allocator<T>().deallocate(data, count);
+        }
+
+        template<typename U>
+        bool operator==(const DecodeAllocator<U>&) const noexcept
+        {
+            return true;
+        }
+        template<typename U>
+        bool operator!=(const DecodeAllocator<U>&) const noexcept
+        {
+            return false;
+        }
+    };
+
+    // Raw interleaved samples in whichever SampleFormat they were decoded to
+    using SampleBuffer = std::vector<uint8_t, DecodeAllocator<uint8_t>>;
+
+    // Where every frame of an MP3 starts, which minimp3 otherwise finds by scanning the whole file when
+    // it's opened. A clip builds it once and shares it with all its decoders, they open without the scan
+    struct Mp3SeekIndex
+    {
+        struct Frame
+        {
+            uint64_t Sample; // interleaved
+            uint64_t Offset; // in bytes
+        };
+
+        std::vector<Frame> Frames;
+        uint64_t Samples{}; // interleaved, in the whole file
+    };
+
+    // Incremental decoder producing interleaved 16-bit or float PCM, used where a
+    // file is played without decoding it up front
+    class AudioDecoder
+    {
+    public:
+        virtual ~AudioDecoder() = default;
+
+        // Decodes up to frameCount frames into out, returns the number of frames
+        // written. Returns 0 once the end of the stream is reached
+        virtual size_t Read(int16_t* out, size_t frameCount) = 0;
+        virtual size_t Read(float* out, size_t frameCount) = 0;
+        size_t Read(void* out, size_t frameCount, SampleFormat format);
+        virtual bool Seek(uint64_t frame) = 0;
+        // The index this decoder seeks with, built on the first call. nullptr for formats that don't need one
+        virtual std::shared_ptr<const Mp3SeekIndex> GetSeekIndex() { return nullptr; }
+
+        [[nodiscard]] uint32_t GetSampleRate() const { return mSampleRate; }
+        [[nodiscard]] uint32_t GetChannels() const { return mChannels; }
+        [[nodiscard]] uint64_t GetTotalFrames() const { return mTotalFrames; }
+
+    protected:
+        uint32_t mSampleRate{};
+        uint32_t mChannels{};
+        uint64_t mTotalFrames{};
+    };
+
+    // All of these return nullptr if the data can't be opened or isn't a supported format.
+    // seekIndex has to come from GetSeekIndex on a decoder of the same data, it's ignored for anything but MP3.
+    // Either sample type can be read from any decoder, sampleFormat only picks the one it decodes to without converting
+    std::unique_ptr<AudioDecoder> OpenDecoder(const std::string& filename, SampleFormat sampleFormat = SampleFormat::Int16,
+                                              std::shared_ptr<const Mp3SeekIndex> seekIndex = {});
+    // The memory isn't copied and has to outlive the decoder
+    std::unique_ptr<AudioDecoder> OpenDecoder(const void* data, size_t size, AudioFileFormat format,
+                                              SampleFormat sampleFormat = SampleFormat::Int16,
+                                              std::shared_ptr<const Mp3SeekIndex> seekIndex = {});
+    std::unique_ptr<AudioDecoder> OpenDecoder(std::unique_ptr<AudioReader> reader, AudioFileFormat format,
+                                              SampleFormat sampleFormat = SampleFormat::Int16,
+                                              std::shared_ptr<const Mp3SeekIndex> seekIndex = {});
+
+    class MappedFile;
+
+    struct DecodedAudio
+    {
+        SampleBuffer Samples; // interleaved, freed once uploaded
+        std::unique_ptr<MappedFile> CachedFile; // set instead of Samples when the PCM came from the disk cache
+        size_t CachedOffset{};                  // where the PCM starts in CachedFile
+        uint32_t SampleRate{};
+        uint32_t Channels{};
+        SampleFormat Format{};
+        uint32_t PaddingFrames{}; // silence filling up the last ADPCM block
+
+        DecodedAudio();
+        DecodedAudio(DecodedAudio&&) noexcept;
+        DecodedAudio& operator=(DecodedAudio&&) noexcept;
+        ~DecodedAudio();
+
+        [[nodiscard]] const void* GetData() const;
+        [[nodiscard]] size_t GetSize() const; // in bytes
+        [[nodiscard]] uint64_t GetFrameCount() const; // without the padding
+    };
+
+    // Decodes a whole file into exactly sized storage, or maps it from the PCM cache
+    // if enabled and up to date. Safe to run on any thread
+    bool DecodeFile(const std::string& filename, SampleFormat format, DecodedAudio& audio);
+    bool DecodeAll(AudioDecoder& decoder, SampleFormat format, DecodedAudio& audio);
+} // namespace Hazel::Audio
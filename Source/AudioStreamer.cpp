@@ -0,0 +1,273 @@
+#include "AudioStreamer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "BufferPool.h"
+
+namespace Hazel::Audio
+{
+    using namespace std::literals::chrono_literals;
+
+    // Guards the registry and the refill thread's state, each streamer has its own mutex on top.
+    // Lock order is s_StreamMutex before a streamer's mutex
+    static std::mutex s_StreamMutex;
+    static std::condition_variable s_RefillCondition;
+    static std::vector<AudioStreamer*> s_Streamers;
+    static std::vector<AudioStreamer*> s_RefillList; // refill thread only
+    static std::thread s_RefillThread;
+    static bool s_RefillThreadRunning{};
+
+    // Each buffer holds ~370ms of 44.1kHz stereo, polling well below that keeps the queue full
+    static constexpr auto RefillInterval = 10ms;
+
+    AudioStreamer::AudioStreamer(uint32_t source, std::unique_ptr<AudioDecoder> decoder, SampleFormat sampleFormat)
+        : mSourceHandle(source), mDecoder(std::move(decoder)), mSampleFormat(sampleFormat),
+          mFormat(GetOpenAlFormat(mDecoder->GetChannels(), sampleFormat))
+    {
+        for (uint32_t& buffer : mBuffers)
+        {
+            buffer = AcquireBuffer();
+            if (!buffer)
+            {
+                // Out of AL buffers, give back the ones we got and stay invalid
+                for (uint32_t& acquired : mBuffers)
+                {
+                    ReleaseBuffer(acquired);
+                    acquired = 0;
+                }
+                return;
+            }
+        }
+        mChunk.resize(BufferSize);
+
+        std::lock_guard lock(s_StreamMutex);
+        s_Streamers.push_back(this);
+    }
+
+    AudioStreamer::~AudioStreamer()
+    {
+        // Never registered and never touched the source
+        if (!IsValid())
+            return;
+
+        {
+            std::lock_guard lock(s_StreamMutex);
+            s_Streamers.erase(std::find(s_Streamers.begin(), s_Streamers.end(), this));
+        }
+
+        // Waits out a refill of this stream that's already underway, the refill thread won't pick it up again
+        std::lock_guard lock(mMutex);
+        alSourceStop(mSourceHandle);
+        alSourcei(mSourceHandle, AL_BUFFER, 0);
+        for (const uint32_t buffer : mBuffers)
+            ReleaseBuffer(buffer);
+    }
+
+    void AudioStreamer::Play(uint64_t startFrame)
+    {
+        std::lock_guard lock(mMutex);
+        QueueFrom(startFrame);
+        alSourcePlay(mSourceHandle);
+        mActive = true;
+        s_RefillCondition.notify_one();
+    }
+
+    void AudioStreamer::Prepare(uint64_t startFrame)
+    {
+        std::lock_guard lock(mMutex);
+        QueueFrom(startFrame);
+    }
+
+    void AudioStreamer::Started()
+    {
+        // Until now the refill thread left the stream alone, it would have started the source itself
+        mActive = true;
+        s_RefillCondition.notify_one();
+    }
+
+    void AudioStreamer::Seek(uint64_t frame)
+    {
+        std::lock_guard lock(mMutex);
+
+        ALenum state;
+        alGetSourcei(mSourceHandle, AL_SOURCE_STATE, &state);
+
+        // Dropping the queue of a paused stream makes the next Play queue up again from its startFrame
+        ResetQueue();
+        if (state == AL_PAUSED)
+            return;
+
+        QueueFrom(frame);
+        alSourcePlay(mSourceHandle);
+        mActive = true;
+        s_RefillCondition.notify_one();
+    }
+
+    void AudioStreamer::Pause()
+    {
+        std::lock_guard lock(mMutex);
+        alSourcePause(mSourceHandle);
+    }
+
+    void AudioStreamer::Stop()
+    {
+        std::lock_guard lock(mMutex);
+        ResetQueue();
+    }
+
+    void AudioStreamer::SetLoop(bool loop)
+    {
+        std::lock_guard lock(mMutex);
+        mLoop = loop;
+    }
+
+    bool AudioStreamer::IsFinished() const
+    {
+        return !mActive;
+    }
+
+    uint64_t AudioStreamer::GetPlaybackFrame() const
+    {
+        std::lock_guard lock(mMutex);
+
+        ALint offset{};
+        alGetSourcei(mSourceHandle, AL_SAMPLE_OFFSET, &offset);
+        const uint64_t frame = mQueueStartFrame + static_cast<uint64_t>(offset);
+
+        const uint64_t totalFrames = mDecoder->GetTotalFrames();
+        return totalFrames > 0 ? frame % totalFrames : frame;
+    }
+
+    void AudioStreamer::Refill()
+    {
+        ALint processed{};
+        alGetSourcei(mSourceHandle, AL_BUFFERS_PROCESSED, &processed);
+        while (processed-- > 0)
+        {
+            uint32_t buffer;
+            alSourceUnqueueBuffers(mSourceHandle, 1, &buffer);
+
+            const size_t slot = std::find(std::begin(mBuffers), std::end(mBuffers), buffer) - std::begin(mBuffers);
+            mQueueStartFrame += mBufferFrames[slot];
+            mBufferFrames[slot] = FillBuffer(buffer);
+            if (mBufferFrames[slot] > 0)
+                alSourceQueueBuffers(mSourceHandle, 1, &buffer);
+        }
+
+        ALenum state;
+        alGetSourcei(mSourceHandle, AL_SOURCE_STATE, &state);
+        if (state == AL_PLAYING || state == AL_PAUSED)
+            return;
+
+        ALint queued{};
+        alGetSourcei(mSourceHandle, AL_BUFFERS_QUEUED, &queued);
+        if (queued > 0)
+            alSourcePlay(mSourceHandle); // the queue ran dry before we got to it, resume
+        else
+            mActive = false; // end of stream
+    }
+
+    size_t AudioStreamer::FillBuffer(uint32_t buffer)
+    {
+        const size_t frameSize = GetBlockSize(mSampleFormat, mDecoder->GetChannels());
+        const size_t frameCount = mChunk.size() / frameSize;
+
+        size_t framesRead = mDecoder->Read(mChunk.data(), frameCount, mSampleFormat);
+        while (mLoop && framesRead < frameCount)
+        {
+            if (!mDecoder->Seek(0))
+                break;
+
+            const size_t read = mDecoder->Read(mChunk.data() + framesRead * frameSize, frameCount - framesRead, mSampleFormat);
+            if (read == 0)
+                break;
+            framesRead += read;
+        }
+
+        if (framesRead == 0)
+            return 0;
+
+        const auto size = static_cast<ALsizei>(framesRead * frameSize);
+        alBufferData(buffer, mFormat, mChunk.data(), size, static_cast<ALsizei>(mDecoder->GetSampleRate()));
+        return framesRead;
+    }
+
+    void AudioStreamer::ResetQueue()
+    {
+        alSourceStop(mSourceHandle);
+        alSourcei(mSourceHandle, AL_BUFFER, 0);
+        mDecoder->Seek(0);
+        mQueueStartFrame = 0;
+        mActive = false;
+    }
+
+    void AudioStreamer::QueueFrom(uint64_t startFrame)
+    {
+        ALenum state;
+        alGetSourcei(mSourceHandle, AL_SOURCE_STATE, &state);
+        if (state == AL_PAUSED)
+            return;
+
+        // Like alSourcePlay on a static buffer, playing restarts rather than continuing
+        ResetQueue();
+        if (startFrame > 0 && mDecoder->Seek(startFrame))
+            mQueueStartFrame = startFrame;
+
+        for (size_t slot = 0; slot < BufferCount; slot++)
+        {
+            mBufferFrames[slot] = FillBuffer(mBuffers[slot]);
+            if (mBufferFrames[slot] == 0)
+                break;
+            alSourceQueueBuffers(mSourceHandle, 1, &mBuffers[slot]);
+        }
+    }
+
+    void AudioStreamer::StartRefillThread()
+    {
+        std::lock_guard lock(s_StreamMutex);
+        if (s_RefillThreadRunning)
+            return;
+
+        s_RefillThreadRunning = true;
+        s_RefillThread = std::thread([]
+        {
+            std::unique_lock lock(s_StreamMutex);
+            while (s_RefillThreadRunning)
+            {
+                // The registry is only locked between streams, creating or destroying one never waits for a whole pass
+                s_RefillList = s_Streamers;
+                for (auto* streamer : s_RefillList)
+                {
+                    if (std::find(s_Streamers.begin(), s_Streamers.end(), streamer) == s_Streamers.end())
+                        continue; // destroyed in the meantime
+
+                    std::unique_lock streamLock(streamer->mMutex);
+                    lock.unlock();
+                    if (streamer->mActive)
+                        streamer->Refill();
+                    streamLock.unlock();
+                    lock.lock();
+                }
+
+                s_RefillCondition.wait_for(lock, RefillInterval);
+            }
+        });
+    }
+
+    void AudioStreamer::StopRefillThread()
+    {
+        {
+            std::lock_guard lock(s_StreamMutex);
+            if (!s_RefillThreadRunning)
+                return;
+            s_RefillThreadRunning = false;
+        }
+
+        s_RefillCondition.notify_one();
+        s_RefillThread.join();
+    }
+} // namespace Hazel::Audio
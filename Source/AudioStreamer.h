@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "AudioDecoder.h"
+
+namespace Hazel::Audio
+{
+    // Plays a decoder through a small ring of queued AL buffers which the
+    // background refill thread keeps topped up, so memory use doesn't depend
+    // on the length of the track
+    class AudioStreamer
+    {
+    public:
+        static constexpr uint32_t BufferCount = 4;
+        static constexpr size_t BufferSize = 64 * 1024; // in bytes
+
+        AudioStreamer(uint32_t source, std::unique_ptr<AudioDecoder> decoder, SampleFormat sampleFormat);
+        AudioStreamer(const AudioStreamer&) = delete;
+        ~AudioStreamer();
+
+        // False when the AL buffers couldn't be generated, an invalid streamer must not be played
+        [[nodiscard]] bool IsValid() const { return mBuffers[0] != 0; }
+
+        // Resumes a paused stream, otherwise starts over from startFrame
+        void Play(uint64_t startFrame = 0);
+        // Play split in two, so the source can be started together with others through alSourcePlayv.
+        // Prepare queues the first buffers, Started hands the stream to the refill thread once it plays
+        void Prepare(uint64_t startFrame = 0);
+        void Started();
+        // A playing stream jumps there right away, a paused one starts over from the startFrame of the next Play
+        void Seek(uint64_t frame);
+        void Pause();
+        void Stop();
+        void SetLoop(bool loop);
+        // True once the end of the stream was played, or before the first Play
+        [[nodiscard]] bool IsFinished() const;
+        // The frame currently being played, wrapped around for looping streams
+        [[nodiscard]] uint64_t GetPlaybackFrame() const;
+
+        static void StartRefillThread();
+        static void StopRefillThread();
+
+    private:
+        // All of these expect mMutex to be held
+        void Refill();
+        size_t FillBuffer(uint32_t buffer); // returns the number of frames, 0 at the end of the stream
+        void ResetQueue();
+        void QueueFrom(uint64_t startFrame);
+
+        uint32_t mSourceHandle{};
+        uint32_t mBuffers[BufferCount]{};
+        size_t mBufferFrames[BufferCount]{}; // what each of mBuffers holds
+        uint64_t mQueueStartFrame{};         // decoder frame at the start of the oldest queued buffer, keeps counting past loops
+        std::unique_ptr<AudioDecoder> mDecoder;
+        SampleBuffer mChunk;
+        SampleFormat mSampleFormat{};
+        ALenum mFormat{};
+        // Guards everything but mActive. Held while the refill thread decodes this stream only, so calls
+        // on one stream never wait for the others to be decoded
+        mutable std::mutex mMutex;
+        std::atomic<bool> mActive{}; // set from Play until Stop or the end of the stream
+        bool mLoop{};
+    };
+} // namespace Hazel::Audio
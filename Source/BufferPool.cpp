@@ -0,0 +1,70 @@
+#include "BufferPool.h"
+
+#include <mutex>
+#include <vector>
+
+#include "al.h"
+#include "alext.h"
+
+namespace Hazel::Audio
+{
+    // Clips can be released from any thread holding the last reference
+    static std::mutex s_BufferPoolMutex;
+    static std::vector<uint32_t> s_FreeBuffers;
+    static bool s_BufferPoolActive{};
+
+    static constexpr uint32_t GrowCount = 16;
+
+    static void GenerateBuffers(uint32_t count)
+    {
+        const size_t offset = s_FreeBuffers.size();
+        s_FreeBuffers.resize(offset + count);
+        alGetError(); // clear whatever error was left over
+        alGenBuffers(static_cast<ALsizei>(count), s_FreeBuffers.data() + offset);
+        if (alGetError() != AL_NO_ERROR)
+            s_FreeBuffers.resize(offset);
+    }
+
+    void InitBufferPool(uint32_t capacity)
+    {
+        std::lock_guard lock(s_BufferPoolMutex);
+        s_BufferPoolActive = true;
+        if (capacity > 0)
+            GenerateBuffers(capacity);
+    }
+
+    void ShutdownBufferPool()
+    {
+        std::lock_guard lock(s_BufferPoolMutex);
+        alDeleteBuffers(static_cast<ALsizei>(s_FreeBuffers.size()), s_FreeBuffers.data());
+        s_FreeBuffers.clear();
+        s_BufferPoolActive = false;
+    }
+
+    uint32_t AcquireBuffer()
+    {
+        std::lock_guard lock(s_BufferPoolMutex);
+        if (s_FreeBuffers.empty())
+            GenerateBuffers(GrowCount);
+        if (s_FreeBuffers.empty())
+            return 0;
+
+        const uint32_t buffer = s_FreeBuffers.back();
+        s_FreeBuffers.pop_back();
+        return buffer;
+    }
+
+    void ReleaseBuffer(uint32_t buffer)
+    {
+        std::lock_guard lock(s_BufferPoolMutex);
+        // Buffers outliving Shutdown went away with the context
+        if (!buffer || !s_BufferPoolActive)
+            return;
+
+        // An empty upload frees the samples but keeps the name. ADPCM clips change the unpack
+        // alignment, which would otherwise break the next plain PCM upload into this buffer
+        alBufferi(buffer, AL_UNPACK_BLOCK_ALIGNMENT_SOFT, 0);
+        alBufferData(buffer, AL_FORMAT_MONO16, nullptr, 0, 44100);
+        s_FreeBuffers.push_back(buffer);
+    }
+} // namespace Hazel::Audio
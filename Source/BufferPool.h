@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Hazel::Audio
+{
+    // AL buffer names are created up front and recycled, so loading a clip or starting a
+    // stream doesn't have to create AL objects. Called from Init and Shutdown
+    void InitBufferPool(uint32_t capacity);
+    void ShutdownBufferPool();
+
+    // Grows the pool in batches if it runs dry, returns 0 if OpenAL can't create more
+    uint32_t AcquireBuffer();
+    // Frees the buffer's sample data, it must not be attached to a source anymore
+    void ReleaseBuffer(uint32_t buffer);
+} // namespace Hazel::Audio
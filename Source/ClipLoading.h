@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Hazel::Audio
+{
+    // Called from Init, Shutdown and Update respectively
+    void InitClipLoading(uint32_t decodeThreads);
+    void ShutdownClipLoading();
+    // Uploads clips decoded by the worker pool and runs their callbacks, on the thread owning the context
+    void ProcessCompletedClipLoads();
+} // namespace Hazel::Audio
@@ -1,72 +1,37 @@
 #include "HazelAudio/HazelAudio.h"
 
-#include <filesystem>
-#include <string>
 #include <cassert>
+#include <string>
+#include <vector>
 
 #include "al.h"
 #include "alc.h"
 #include "alext.h"
 #include "alhelpers.h"
-
-#define MINIMP3_IMPLEMENTATION
-#include "minimp3.h"
-#include "minimp3_ex.h"
-
-#include "vorbis/codec.h"
-#include "vorbis/vorbisfile.h"
-
-#define ASSERTMSG(exp, msg) assert(((void)msg, exp));
+#include "AudioDecoder.h"
+#include "AudioStreamer.h"
+#include "BufferPool.h"
+#include "ClipLoading.h"
+#include "MixerBus.h"
+#include "PcmCache.h"
+#include "VoiceManager.h"
 
 namespace Hazel::Audio
 {
     static ALCdevice* s_AudioDevice{};
-    static mp3dec_t s_Mp3d;
-
-    static uint8_t* s_AudioScratchBuffer;
-    static uint32_t s_AudioScratchBufferSize = 10 * 1024 * 1024; // 10mb initially
-
-    // Currently supported file formats
-    enum class AudioFileFormat
-    {
-        None = 0,
-        Ogg,
-        MP3
-    };
+    static uint32_t s_UpdateDepth{};
 
-    static AudioFileFormat GetFileFormat(const std::string& filename)
-    {
-        const std::filesystem::path path = filename;
-        const std::string extension = path.extension().string();
-
-        if (extension == ".ogg")
-            return AudioFileFormat::Ogg;
-        if (extension == ".mp3")
-            return AudioFileFormat::MP3;
-
-        return AudioFileFormat::None;
-    }
-
-    static ALenum GetOpenAlFormat(uint32_t channels)
-    {
-        // Note: sample size is always 2 bytes (16-bits) with
-        // both the .mp3 and .ogg decoders that we're using
-        switch (channels)
-        {
-        case 1: return AL_FORMAT_MONO16;
-        case 2: return AL_FORMAT_STEREO16;
-        default: assert(false);
-        }
-    }
-
-    bool Init()
+    bool Init(const InitSettings& settings)
     {
         if (InitAL(s_AudioDevice, nullptr, nullptr) != 0)
             return false;
 
-        mp3dec_init(&s_Mp3d);
-
-        s_AudioScratchBuffer = new uint8_t[s_AudioScratchBufferSize];
+        SetPcmCacheDirectory(settings.PcmCacheDirectory);
+        InitBuses();
+        InitBufferPool(settings.BufferCapacity);
+        InitClipLoading(settings.DecodeThreads);
+        InitVoices(settings.MaxVoices);
+        AudioStreamer::StartRefillThread();
 
         // Init listener
         constexpr ALfloat listenerPos[] = {0.0, 0.0, 0.0};
@@ -81,7 +46,36 @@ namespace Hazel::Audio
 
     void Shutdown()
     {
+        ShutdownVoices();
+        AudioStreamer::StopRefillThread();
+        ShutdownClipLoading();
+        ShutdownBufferPool();
+
         CloseAL();
+        s_UpdateDepth = 0; // deferral state went away with the context
+    }
+
+    void Update()
+    {
+        BeginUpdate();
+        ProcessCompletedClipLoads();
+        UpdateVoices();
+        EndUpdate();
+    }
+
+    void BeginUpdate()
+    {
+        if (s_UpdateDepth++ == 0)
+            alDeferUpdatesSOFT();
+    }
+
+    void EndUpdate()
+    {
+        if (s_UpdateDepth == 0)
+            return;
+
+        if (--s_UpdateDepth == 0)
+            alProcessUpdatesSOFT();
     }
 
     void SetGlobalVolume(float volume)
@@ -89,108 +83,392 @@ namespace Hazel::Audio
         alListenerf(AL_GAIN, volume);
     }
 
-    bool Source::LoadOgg(const std::string& filename)
+    Voice::Voice(SourceHandle handle) : mHandle(handle)
+    {
+    }
+
+    void Voice::Stop() const
+    {
+        if (auto* voice = GetVoice(mHandle))
+            DestroyVoice(*voice);
+    }
+
+    void Voice::SetPosition(float x, float y, float z) const
+    {
+        SetSourcePosition(mHandle, x, y, z);
+    }
+
+    void Voice::SetGain(float gain) const
+    {
+        SetSourceGain(mHandle, gain);
+    }
+
+    void Voice::SetPitch(float pitch) const
+    {
+        SetSourcePitch(mHandle, pitch);
+    }
+
+    void Voice::SetPriority(int priority) const
+    {
+        SetSourcePriority(mHandle, priority);
+    }
+
+    void Voice::SetCategory(uint32_t category) const
+    {
+        SetSourceCategory(mHandle, category);
+    }
+
+    bool Voice::IsPlaying() const
+    {
+        return IsSourcePlaying(mHandle);
+    }
+
+    // Returns the voice now playing the clip, which might start out virtual
+    static SourceHandle StartOneShot(const std::shared_ptr<AudioClip>& clip, const float* position, float gain)
+    {
+        if (!clip || clip->GetStorage() != ClipStorage::Decoded)
+            return {};
+
+        const SourceHandle handle = CreateVoice();
+        VoiceState& voice = *GetVoice(handle);
+        voice.OneShot = true;
+        voice.Clip = clip;
+        voice.Gain = gain;
+        if (position)
+        {
+            SetVoicePosition(voice, position[0], position[1], position[2]);
+            voice.Spatialize = AL_TRUE;
+            alDistanceModel(AL_INVERSE_DISTANCE_CLAMPED);
+        }
+        else
+        {
+            voice.Spatialize = AL_FALSE;
+        }
+
+        PlayVoice(voice);
+        return handle;
+    }
+
+    Voice PlayOneShot(const std::shared_ptr<AudioClip>& clip, float gain)
     {
-        FILE* f = fopen(filename.c_str(), "rb");
+        return Voice(StartOneShot(clip, nullptr, gain));
+    }
+
+    Voice PlayOneShot(const std::shared_ptr<AudioClip>& clip, float x, float y, float z, float gain)
+    {
+        const float position[] = {x, y, z};
+        return Voice(StartOneShot(clip, position, gain));
+    }
 
-        OggVorbis_File vf;
-        if (ov_open_callbacks(f, &vf, nullptr, 0, OV_CALLBACKS_NOCLOSE) < 0)
+    SourceHandle CreateSource(std::shared_ptr<AudioClip> clip)
+    {
+        const SourceHandle source = CreateVoice();
+        SetSourceClip(source, std::move(clip));
+        return source;
+    }
+
+    void DestroySource(SourceHandle source)
+    {
+        if (auto* voice = GetVoice(source))
+            DestroyVoice(*voice);
+    }
+
+    bool IsSourceValid(SourceHandle source)
+    {
+        return GetVoice(source) != nullptr;
+    }
+
+    bool SetSourceClip(SourceHandle source, std::shared_ptr<AudioClip> clip)
+    {
+        auto* voice = GetVoice(source);
+        if (!voice || !clip)
             return false;
 
-        vorbis_info* vi = ov_info(&vf, -1);
-        const auto sampleRate = vi->rate;
-        const auto channels = vi->channels;
-        const auto alFormat = GetOpenAlFormat(channels);
-        const auto samples = ov_pcm_total(&vf, -1);
-        const auto bufferSize = 2 * channels * samples; // 2 bytes per sample (I'm guessing...)
+        SetVoiceClip(*voice, std::move(clip));
+        return true;
+    }
+
+    void PlaySource(SourceHandle source)
+    {
+        if (auto* voice = GetVoice(source))
+            PlayVoice(*voice);
+    }
+
+    void PauseSource(SourceHandle source)
+    {
+        if (auto* voice = GetVoice(source))
+            PauseVoice(*voice);
+    }
+
+    void StopSource(SourceHandle source)
+    {
+        if (auto* voice = GetVoice(source))
+            StopVoice(*voice);
+    }
+
+    void SeekSource(SourceHandle source, float seconds)
+    {
+        if (auto* voice = GetVoice(source))
+            SeekVoice(*voice, seconds);
+    }
+
+    void SetSourcePosition(SourceHandle source, float x, float y, float z)
+    {
+        if (auto* voice = GetVoice(source))
+            SetVoicePosition(*voice, x, y, z);
+    }
+
+    void SetSourceVelocity(SourceHandle source, float x, float y, float z)
+    {
+        if (auto* voice = GetVoice(source))
+            SetVoiceVelocity(*voice, x, y, z);
+    }
+
+    void SetSourceGain(SourceHandle source, float gain)
+    {
+        if (auto* voice = GetVoice(source))
+            SetVoiceGain(*voice, gain);
+    }
+
+    void SetSourceVolume(SourceHandle source, float volume)
+    {
+        if (auto* voice = GetVoice(source))
+            SetVoiceVolume(*voice, volume);
+    }
 
-        if (s_AudioScratchBufferSize < bufferSize)
+    void SetSourceBus(SourceHandle source, BusHandle bus)
+    {
+        if (auto* voice = GetVoice(source))
+            SetVoiceBus(*voice, bus);
+    }
+
+    void SetSourcePitch(SourceHandle source, float pitch)
+    {
+        if (auto* voice = GetVoice(source))
+            SetVoicePitch(*voice, pitch);
+    }
+
+    void SetSourceSpatial(SourceHandle source, bool spatial)
+    {
+        if (auto* voice = GetVoice(source))
         {
-            s_AudioScratchBufferSize = bufferSize;
-            delete[] s_AudioScratchBuffer;
-            s_AudioScratchBuffer = new uint8_t[s_AudioScratchBufferSize];
+            SetVoiceSpatialize(*voice, spatial ? AL_TRUE : AL_FALSE);
+            alDistanceModel(AL_INVERSE_DISTANCE_CLAMPED);
         }
+    }
+
+    void SetSourceLoop(SourceHandle source, bool loop)
+    {
+        if (auto* voice = GetVoice(source))
+            SetVoiceLoop(*voice, loop);
+    }
+
+    void SetSourcePriority(SourceHandle source, int priority)
+    {
+        if (auto* voice = GetVoice(source))
+            voice->Priority = priority;
+    }
 
-        uint8_t* oggBuffer = s_AudioScratchBuffer;
-        uint8_t* bufferPtr = oggBuffer;
-        while (true)
+    void SetSourceCategory(SourceHandle source, uint32_t category)
+    {
+        if (auto* voice = GetVoice(source))
+            SetVoiceCategory(*voice, category);
+    }
+
+    void SetSourceOnFinished(SourceHandle source, std::function<void()> callback)
+    {
+        if (auto* voice = GetVoice(source))
+            voice->OnFinished = std::move(callback);
+    }
+
+    bool IsSourcePlaying(SourceHandle source)
+    {
+        auto* voice = GetVoice(source);
+        return voice && GetVoiceState(*voice) == PlayState::Playing;
+    }
+
+    bool IsSourcePaused(SourceHandle source)
+    {
+        auto* voice = GetVoice(source);
+        return voice && GetVoiceState(*voice) == PlayState::Paused;
+    }
+
+    bool IsSourceStopped(SourceHandle source)
+    {
+        auto* voice = GetVoice(source);
+        return voice && GetVoiceState(*voice) == PlayState::Stopped;
+    }
+
+    bool IsSourceVirtual(SourceHandle source)
+    {
+        // Stopped and paused voices don't hold a source either, that doesn't make them virtual
+        const auto* voice = GetVoice(source);
+        return voice && voice->State == PlayState::Playing && voice->SourceHandle == 0;
+    }
+
+    float GetSourcePlaybackPosition(SourceHandle source)
+    {
+        const auto* voice = GetVoice(source);
+        return voice ? GetVoicePlaybackPosition(*voice) : 0.0f;
+    }
+
+    template<typename GetVoiceFunc>
+    static void ApplyEmitters(size_t count, const float* positions, const float* velocities, const float* gains,
+                              GetVoiceFunc&& getVoice)
+    {
+        BeginUpdate();
+        for (size_t i = 0; i < count; i++)
         {
-            int currentSection{};
-            const auto length = ov_read(&vf, reinterpret_cast<char*>(bufferPtr), 4096, 0, 2, 1, &currentSection);
-            bufferPtr += length;
-            if (length == 0)
-                break;
-            else if (length < 0)
-                ASSERTMSG(length == OV_EBADLINK, "Corrupt bitstream section!")
+            VoiceState* voice = getVoice(i);
+            if (!voice)
+                continue;
+
+            if (positions)
+                SetVoicePosition(*voice, positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2]);
+            if (velocities)
+                SetVoiceVelocity(*voice, velocities[i * 3], velocities[i * 3 + 1], velocities[i * 3 + 2]);
+            if (gains)
+                SetVoiceGain(*voice, gains[i]);
         }
+        EndUpdate();
+    }
+
+    void SetEmitters(const SourceHandle* sources, size_t count, const float* positions, const float* velocities,
+                     const float* gains)
+    {
+        ApplyEmitters(count, positions, velocities, gains, [&](size_t i) { return GetVoice(sources[i]); });
+    }
+
+    void SetEmitters(Source* const* sources, size_t count, const float* positions, const float* velocities,
+                     const float* gains)
+    {
+        ApplyEmitters(count, positions, velocities, gains, [&](size_t i) { return GetVoice(sources[i]->GetHandle()); });
+    }
 
-        const auto size = bufferPtr - oggBuffer;
-        ASSERTMSG(bufferSize == size, "Buffer size equals size of ogg buffer!")
+    void SetPositions(const SourceHandle* sources, size_t count, const float* positions)
+    {
+        SetEmitters(sources, count, positions);
+    }
 
-        // Release file
-        ov_clear(&vf);
-        fclose(f);
+    void SetPositions(Source* const* sources, size_t count, const float* positions)
+    {
+        SetEmitters(sources, count, positions);
+    }
 
-        alGenBuffers(1, &mBufferHandle);
-        alBufferData(mBufferHandle, alFormat, oggBuffer, static_cast<int>(size), static_cast<int>(sampleRate));
-        alGenSources(1, &mSourceHandle);
-        alSourcei(mSourceHandle, AL_BUFFER, static_cast<int>(mBufferHandle));
+    static std::vector<VoiceState*> s_GroupVoices; // reused by PlayGroup
 
-        if (alGetError() != AL_NO_ERROR)
-            return false;
+    template<typename GetHandleFunc>
+    static void PlayVoiceGroup(size_t count, GetHandleFunc&& getHandle)
+    {
+        s_GroupVoices.clear();
+        for (size_t i = 0; i < count; i++)
+        {
+            if (VoiceState* voice = GetVoice(getHandle(i)))
+                s_GroupVoices.push_back(voice);
+        }
 
-        mTotalDuration = static_cast<float>(samples) / static_cast<float>(sampleRate); // in seconds
-        mLoaded = true;
+        PlayVoices(s_GroupVoices.data(), s_GroupVoices.size());
+    }
 
-        return true;
+    void PlayGroup(const SourceHandle* sources, size_t count)
+    {
+        PlayVoiceGroup(count, [&](size_t i) { return sources[i]; });
     }
 
-    bool Source::LoadMp3(const std::string& filename)
+    void PlayGroup(Source* const* sources, size_t count)
     {
-        mp3dec_file_info_t info;
-        mp3dec_load(&s_Mp3d, filename.c_str(), &info, nullptr, nullptr);
-        const auto size = info.samples * sizeof(mp3d_sample_t);
+        PlayVoiceGroup(count, [&](size_t i) { return sources[i]->GetHandle(); });
+    }
 
-        const auto sampleRate = info.hz;
-        const auto channels = info.channels;
-        const auto alFormat = GetOpenAlFormat(channels);
+    uint64_t GetDeviceClock()
+    {
+        ALCint64SOFT clock{};
+        if (s_AudioDevice)
+            alcGetInteger64vSOFT(s_AudioDevice, ALC_DEVICE_CLOCK_SOFT, 1, &clock);
+        return static_cast<uint64_t>(clock);
+    }
 
-        alGenBuffers(1, &mBufferHandle);
-        alBufferData(mBufferHandle, alFormat, info.buffer, static_cast<int>(size), sampleRate);
-        alGenSources(1, &mSourceHandle);
-        alSourcei(mSourceHandle, AL_BUFFER, static_cast<int>(mBufferHandle));
+    void PlayGroupAt(const SourceHandle* sources, size_t count, uint64_t startTime)
+    {
+        ScheduleVoices({sources, sources + count}, startTime);
+    }
 
-        if (alGetError() != AL_NO_ERROR)
-            return false;
+    void PlayGroupAt(Source* const* sources, size_t count, uint64_t startTime)
+    {
+        std::vector<SourceHandle> handles(count);
+        for (size_t i = 0; i < count; i++)
+            handles[i] = sources[i]->GetHandle();
 
-        mTotalDuration = static_cast<float>(size) / (static_cast<float>(info.avg_bitrate_kbps) * 1024.0f);
-        mLoaded = true;
+        ScheduleVoices(std::move(handles), startTime);
+    }
 
-        return true;
+    Source::Source() : mHandle(CreateVoice())
+    {
     }
 
-    Source::Source() = default;
+    Source::Source(Source&& other) noexcept : mHandle(other.mHandle), mLoaded(other.mLoaded)
+    {
+        other.mHandle = {};
+        other.mLoaded = false;
+    }
 
-    Source::Source(const std::string& filename)
+    Source::Source(const std::string& filename) : mHandle(CreateVoice())
     {
         LoadFromFile(filename);
     }
 
+    Source::Source(std::shared_ptr<AudioClip> clip) : mHandle(CreateVoice())
+    {
+        SetClip(std::move(clip));
+    }
+
     Source::~Source()
     {
-        alDeleteSources(1, &mSourceHandle);
-        alDeleteBuffers(1, &mBufferHandle);
+        DestroySource(mHandle);
     }
 
-    bool Source::LoadFromFile(const std::string& filename)
+    Source& Source::operator=(Source&& other) noexcept
     {
-        switch (GetFileFormat(filename))
+        if (this != &other)
         {
-        case AudioFileFormat::Ogg: return LoadOgg(filename);
-        case AudioFileFormat::MP3: return LoadMp3(filename);
-        case AudioFileFormat::None: return true;
+            DestroySource(mHandle);
+
+            mHandle = other.mHandle;
+            mLoaded = other.mLoaded;
+            other.mHandle = {};
+            other.mLoaded = false;
         }
-        return false;
+        return *this;
+    }
+
+    bool Source::LoadFromFile(const std::string& filename, ClipStorage storage, SampleFormat sampleFormat)
+    {
+        if (GetFileFormat(filename) == AudioFileFormat::None)
+            return true;
+
+        return SetClip(AudioClip::LoadFromFile(filename, storage, sampleFormat));
+    }
+
+    bool Source::SetClip(std::shared_ptr<AudioClip> clip)
+    {
+        if (!SetSourceClip(mHandle, std::move(clip)))
+            return false;
+
+        mLoaded = true;
+        return true;
+    }
+
+    const std::shared_ptr<AudioClip>& Source::GetClip() const
+    {
+        static const std::shared_ptr<AudioClip> noClip;
+
+        const auto* voice = GetVoice(mHandle);
+        return voice ? voice->Clip : noClip;
+    }
+
+    SourceHandle Source::GetHandle() const
+    {
+        return mHandle;
     }
 
     bool Source::IsLoaded() const
@@ -200,88 +478,143 @@ namespace Hazel::Audio
 
     bool Source::IsPlaying() const
     {
-        ALenum state;
-        alGetSourcei(mSourceHandle, AL_SOURCE_STATE, &state);
-        return state == AL_PLAYING;
+        return IsSourcePlaying(mHandle);
     }
 
     bool Source::IsPaused() const
     {
-        ALenum state;
-        alGetSourcei(mSourceHandle, AL_SOURCE_STATE, &state);
-        return state == AL_PAUSED;
+        return IsSourcePaused(mHandle);
     }
 
     bool Source::IsStopped() const
     {
-        ALenum state;
-        alGetSourcei(mSourceHandle, AL_SOURCE_STATE, &state);
-        return state == AL_STOPPED;
+        return IsSourceStopped(mHandle);
+    }
+
+    bool Source::IsVirtual() const
+    {
+        return IsSourceVirtual(mHandle);
+    }
+
+    float Source::GetPlaybackPosition() const
+    {
+        return GetSourcePlaybackPosition(mHandle);
     }
 
     void Source::Play() const
     {
-        alSourcePlay(mSourceHandle);
+        PlaySource(mHandle);
     }
 
     void Source::Pause() const
     {
-        alSourcePause(mSourceHandle);
+        PauseSource(mHandle);
     }
 
     void Source::Stop() const
     {
-        alSourceStop(mSourceHandle);
+        StopSource(mHandle);
+    }
+
+    void Source::Seek(float seconds) const
+    {
+        SeekSource(mHandle, seconds);
     }
 
     void Source::SetPosition(float x, float y, float z)
     {
-        mPosition[0] = x;
-        mPosition[1] = y;
-        mPosition[2] = z;
+        SetSourcePosition(mHandle, x, y, z);
+    }
 
-        alSourcefv(mSourceHandle, AL_POSITION, mPosition);
+    void Source::SetVelocity(float x, float y, float z)
+    {
+        SetSourceVelocity(mHandle, x, y, z);
     }
 
     void Source::SetGain(float gain)
     {
-        mGain = gain;
-
-        alSourcef(mSourceHandle, AL_GAIN, gain);
+        SetSourceGain(mHandle, gain);
     }
 
     void Source::SetPitch(float pitch)
     {
-        mPitch = pitch;
-
-        alSourcef(mSourceHandle, AL_PITCH, pitch);
+        SetSourcePitch(mHandle, pitch);
     }
 
     void Source::SetSpatial(bool spatial)
     {
-        mSpatial = spatial;
-
-        alSourcei(mSourceHandle, AL_SOURCE_SPATIALIZE_SOFT, spatial ? AL_TRUE : AL_FALSE);
-        alDistanceModel(AL_INVERSE_DISTANCE_CLAMPED);
+        SetSourceSpatial(mHandle, spatial);
     }
 
     void Source::SetLoop(bool loop)
     {
-        mLoop = loop;
+        SetSourceLoop(mHandle, loop);
+    }
+
+    void Source::SetPriority(int priority)
+    {
+        SetSourcePriority(mHandle, priority);
+    }
 
-        alSourcei(mSourceHandle, AL_LOOPING, loop ? AL_TRUE : AL_FALSE);
+    void Source::SetCategory(uint32_t category)
+    {
+        SetSourceCategory(mHandle, category);
+    }
+
+    void Source::SetOnFinished(std::function<void()> callback)
+    {
+        SetSourceOnFinished(mHandle, std::move(callback));
     }
 
     std::pair<uint32_t, uint32_t> Source::GetLengthMinutesAndSeconds() const
     {
-        return {static_cast<uint32_t>(mTotalDuration / 60.0f), static_cast<uint32_t>(mTotalDuration) % 60};
+        const auto& clip = GetClip();
+        const float duration = clip ? clip->GetDuration() : 0.0f;
+        return {static_cast<uint32_t>(duration / 60.0f), static_cast<uint32_t>(duration) % 60};
     }
 
-#pragma clang diagnostic push
-#pragma ide diagnostic ignored "readability-make-member-function-const"
     void Source::SetVolume(float volume)
     {
-        alSourcef(mSourceHandle, AL_GAIN, volume);
+        SetSourceVolume(mHandle, volume);
+    }
+
+    void Source::SetBus(BusHandle bus)
+    {
+        SetSourceBus(mHandle, bus);
+    }
+
+    SourcePool::SourcePool(size_t capacity)
+    {
+        Reserve(capacity);
+    }
+
+    void SourcePool::Reserve(size_t capacity)
+    {
+        mSources.reserve(capacity);
+    }
+
+    size_t SourcePool::Add(std::shared_ptr<AudioClip> clip)
+    {
+        auto& source = mSources.emplace_back();
+        if (clip)
+            source.SetClip(std::move(clip));
+        return mSources.size() - 1;
+    }
+
+    void SourcePool::Remove(size_t index)
+    {
+        // Popping the back for a bad index would destroy some unrelated source
+        assert(index < mSources.size());
+        if (index >= mSources.size())
+            return;
+
+        if (index + 1 < mSources.size())
+            mSources[index] = std::move(mSources.back());
+        mSources.pop_back();
+    }
+
+    void SourcePool::Clear()
+    {
+        mSources.clear();
     }
-#pragma clang diagnostic pop
-} // namespace Hazel::Audio
\ No newline at end of file
+} // namespace Hazel::Audio
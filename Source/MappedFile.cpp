@@ -0,0 +1,110 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Hazel::Audio
+{
+    MappedFile::~MappedFile()
+    {
+        Close();
+    }
+
+#ifdef _WIN32
+    bool MappedFile::Open(const std::string& filename)
+    {
+        Close();
+
+        mFileHandle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                  FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (mFileHandle == INVALID_HANDLE_VALUE)
+        {
+            mFileHandle = nullptr;
+            return false;
+        }
+
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(mFileHandle, &size) || size.QuadPart == 0)
+        {
+            Close();
+            return false;
+        }
+
+        mMappingHandle = CreateFileMappingA(mFileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mMappingHandle)
+        {
+            Close();
+            return false;
+        }
+
+        mData = static_cast<const uint8_t*>(MapViewOfFile(mMappingHandle, FILE_MAP_READ, 0, 0, 0));
+        if (!mData)
+        {
+            Close();
+            return false;
+        }
+
+        mSize = static_cast<size_t>(size.QuadPart);
+        return true;
+    }
+
+    void MappedFile::Close()
+    {
+        if (mData)
+            UnmapViewOfFile(mData);
+        if (mMappingHandle)
+            CloseHandle(mMappingHandle);
+        if (mFileHandle)
+            CloseHandle(mFileHandle);
+
+        mData = nullptr;
+        mSize = 0;
+        mMappingHandle = nullptr;
+        mFileHandle = nullptr;
+    }
+#else
+    bool MappedFile::Open(const std::string& filename)
+    {
+        Close();
+
+        const int file = open(filename.c_str(), O_RDONLY);
+        if (file < 0)
+            return false;
+
+        struct stat info{};
+        if (fstat(file, &info) != 0 || info.st_size == 0)
+        {
+            close(file);
+            return false;
+        }
+
+        void* data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+        close(file); // the mapping keeps its own reference to the file
+        if (data == MAP_FAILED)
+            return false;
+
+        // Decoders walk the file front to back, let the kernel read ahead aggressively
+        madvise(data, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+
+        mData = static_cast<const uint8_t*>(data);
+        mSize = static_cast<size_t>(info.st_size);
+        return true;
+    }
+
+    void MappedFile::Close()
+    {
+        if (mData)
+            munmap(const_cast<uint8_t*>(mData), mSize);
+
+        mData = nullptr;
+        mSize = 0;
+    }
+#endif
+} // namespace Hazel::Audio
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Hazel::Audio
+{
+    // Read-only view of a whole file mapped into memory
+    class MappedFile
+    {
+    public:
+        MappedFile() = default;
+        MappedFile(const MappedFile&) = delete;
+        ~MappedFile();
+
+        bool Open(const std::string& filename);
+        void Close();
+
+        [[nodiscard]] const uint8_t* GetData() const { return mData; }
+        [[nodiscard]] size_t GetSize() const { return mSize; }
+
+    private:
+        const uint8_t* mData{};
+        size_t mSize{};
+#ifdef _WIN32
+        void* mFileHandle{};
+        void* mMappingHandle{};
+#endif
+    };
+} // namespace Hazel::Audio
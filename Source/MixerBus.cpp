@@ -0,0 +1,105 @@
+#include "MixerBus.h"
+
+#include <string>
+#include <vector>
+
+namespace Hazel::Audio
+{
+    struct MixerBus
+    {
+        std::string Name;
+        BusHandle Parent{};
+        float Volume{1.0f};
+        float Gain{1.0f}; // Volume times the parent's gain
+        bool Dirty{};
+        bool Changed{}; // Gain changed in the last UpdateBusGains
+    };
+
+    // Parents are always created before their children, so walking this in order visits a bus' parent first
+    static std::vector<MixerBus> s_Buses;
+    static bool s_BusesDirty{};
+
+    void InitBuses()
+    {
+        s_Buses.clear();
+        s_Buses.push_back({"Master"});
+        s_BusesDirty = false;
+    }
+
+    bool UpdateBusGains()
+    {
+        if (!s_BusesDirty)
+            return false;
+        s_BusesDirty = false;
+
+        bool anyChanged{};
+        for (size_t i = 0; i < s_Buses.size(); i++)
+        {
+            MixerBus& bus = s_Buses[i];
+            const MixerBus* parent = i != MasterBus ? &s_Buses[bus.Parent] : nullptr;
+
+            // Only dirty buses and the subtrees below them are recomputed
+            bus.Changed = false;
+            if (!bus.Dirty && !(parent && parent->Changed))
+                continue;
+
+            const float gain = parent ? bus.Volume * parent->Gain : bus.Volume;
+            bus.Changed = gain != bus.Gain;
+            bus.Gain = gain;
+            bus.Dirty = false;
+            anyChanged |= bus.Changed;
+        }
+
+        return anyChanged;
+    }
+
+    bool IsBusGainChanged(BusHandle bus)
+    {
+        return s_Buses[bus].Changed;
+    }
+
+    float GetBusGain(BusHandle bus)
+    {
+        return s_Buses[bus].Gain;
+    }
+
+    bool IsValidBus(BusHandle bus)
+    {
+        return bus < s_Buses.size();
+    }
+
+    BusHandle CreateBus(const std::string& name, BusHandle parent)
+    {
+        if (!IsValidBus(parent))
+            return InvalidBus;
+
+        const auto bus = static_cast<BusHandle>(s_Buses.size());
+        s_Buses.push_back({name, parent, 1.0f, s_Buses[parent].Gain});
+        return bus;
+    }
+
+    BusHandle FindBus(const std::string& name)
+    {
+        for (size_t i = 0; i < s_Buses.size(); i++)
+        {
+            if (s_Buses[i].Name == name)
+                return static_cast<BusHandle>(i);
+        }
+        return InvalidBus;
+    }
+
+    void SetBusVolume(BusHandle bus, float volume)
+    {
+        if (!IsValidBus(bus) || s_Buses[bus].Volume == volume)
+            return;
+
+        s_Buses[bus].Volume = volume;
+        s_Buses[bus].Dirty = true;
+        s_BusesDirty = true;
+    }
+
+    float GetBusVolume(BusHandle bus)
+    {
+        return IsValidBus(bus) ? s_Buses[bus].Volume : 0.0f;
+    }
+} // namespace Hazel::Audio
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+
+#include "HazelAudio/HazelAudio.h"
+
+namespace Hazel::Audio
+{
+    // Called from Init, recreates the master bus
+    void InitBuses();
+
+    // Recomputes the gains of buses whose volume changed, and their children. Returns
+    // true if any bus gain changed, IsBusGainChanged then tells which ones
+    bool UpdateBusGains();
+    bool IsBusGainChanged(BusHandle bus);
+
+    // Product of the bus' volume and that of all its parents, as of the last UpdateBusGains
+    float GetBusGain(BusHandle bus);
+    bool IsValidBus(BusHandle bus);
+} // namespace Hazel::Audio
@@ -0,0 +1,266 @@
+#include "PcmCache.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include "AudioDecoder.h"
+#include "MappedFile.h"
+
+namespace Hazel::Audio
+{
+    // Cache files are this header followed by the raw interleaved PCM
+    struct PcmCacheHeader
+    {
+        char Magic[4];
+        uint32_t Version;
+        uint64_t SourceSize;
+        int64_t SourceTime;
+        uint64_t PathHash;
+        uint32_t SampleRate;
+        uint32_t Channels;
+        uint32_t Format; // SampleFormat
+        uint32_t PaddingFrames;
+        uint64_t DataSize; // in bytes
+    };
+
+    static constexpr char PcmCacheMagic[4] = {'H', 'Z', 'P', 'C'};
+    static constexpr uint32_t PcmCacheVersion = 2;
+
+    // Seek index files are this header followed by the Mp3SeekIndex frames
+    struct SeekIndexHeader
+    {
+        char Magic[4];
+        uint32_t Version;
+        uint64_t SourceSize;
+        int64_t SourceTime;
+        uint64_t PathHash;
+        uint64_t Samples;
+        uint64_t FrameCount;
+    };
+
+    static constexpr char SeekIndexMagic[4] = {'H', 'Z', 'S', 'I'};
+    static constexpr uint32_t SeekIndexVersion = 1;
+
+    static std::filesystem::path s_CacheDirectory;
+
+    struct SourceFileInfo
+    {
+        std::string Path;
+        uint64_t PathHash{};
+        uint64_t Size{};
+        int64_t Time{};
+    };
+
+    static uint64_t HashString(const std::string& string)
+    {
+        // FNV-1a
+        uint64_t hash = 14695981039346656037ull;
+        for (const char c : string)
+        {
+            hash ^= static_cast<uint8_t>(c);
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    static bool GetSourceFileInfo(const std::string& filename, SourceFileInfo& info)
+    {
+        std::error_code error;
+        const auto path = std::filesystem::weakly_canonical(filename, error);
+        if (error)
+            return false;
+
+        info.Size = std::filesystem::file_size(path, error);
+        if (error)
+            return false;
+
+        const auto time = std::filesystem::last_write_time(path, error);
+        if (error)
+            return false;
+
+        info.Path = path.string();
+        info.PathHash = HashString(info.Path);
+        info.Time = static_cast<int64_t>(time.time_since_epoch().count());
+        return true;
+    }
+
+    // Every format of a file gets its own entry, so clips loaded both ways don't keep replacing each other
+    static std::filesystem::path GetCacheFilename(const SourceFileInfo& info, SampleFormat format)
+    {
+        std::ostringstream name;
+        name << std::hex << info.PathHash;
+        if (format != SampleFormat::Int16)
+            name << '.' << GetSampleFormatName(format);
+        name << ".pcm";
+        return s_CacheDirectory / name.str();
+    }
+
+    static std::filesystem::path GetSeekIndexFilename(const SourceFileInfo& info)
+    {
+        std::ostringstream name;
+        name << std::hex << info.PathHash << ".mp3idx";
+        return s_CacheDirectory / name.str();
+    }
+
+    // Written under a temporary name and renamed, so concurrent loads of the
+    // same file never see a half written entry
+    static void WriteCacheFile(const std::filesystem::path& filename, const void* header, size_t headerSize, const void* data,
+                               size_t dataSize)
+    {
+        std::ostringstream temporaryName;
+        temporaryName << filename.string() << '.' << std::this_thread::get_id() << ".tmp";
+        const std::filesystem::path temporaryFilename = temporaryName.str();
+
+        {
+            std::ofstream file(temporaryFilename, std::ios::binary | std::ios::trunc);
+            if (!file)
+                return;
+
+            file.write(static_cast<const char*>(header), static_cast<std::streamsize>(headerSize));
+            file.write(static_cast<const char*>(data), static_cast<std::streamsize>(dataSize));
+            if (!file)
+            {
+                file.close();
+                std::error_code error;
+                std::filesystem::remove(temporaryFilename, error);
+                return;
+            }
+        }
+
+        std::error_code error;
+        std::filesystem::rename(temporaryFilename, filename, error);
+        if (error)
+            std::filesystem::remove(temporaryFilename, error);
+    }
+
+    void SetPcmCacheDirectory(const std::string& directory)
+    {
+        s_CacheDirectory = directory;
+        if (s_CacheDirectory.empty())
+            return;
+
+        std::error_code error;
+        std::filesystem::create_directories(s_CacheDirectory, error);
+        if (error)
+            s_CacheDirectory.clear();
+    }
+
+    bool LoadCachedPcm(const std::string& filename, SampleFormat format, DecodedAudio& audio)
+    {
+        if (s_CacheDirectory.empty())
+            return false;
+
+        SourceFileInfo info;
+        if (!GetSourceFileInfo(filename, info))
+            return false;
+
+        auto file = std::make_unique<MappedFile>();
+        if (!file->Open(GetCacheFilename(info, format).string()) || file->GetSize() < sizeof(PcmCacheHeader))
+            return false;
+
+        PcmCacheHeader header;
+        memcpy(&header, file->GetData(), sizeof(header));
+
+        // Anything that doesn't match exactly is treated as a miss and gets overwritten
+        if (memcmp(header.Magic, PcmCacheMagic, sizeof(PcmCacheMagic)) != 0 || header.Version != PcmCacheVersion ||
+            header.SourceSize != info.Size || header.SourceTime != info.Time || header.PathHash != info.PathHash ||
+            header.Format != static_cast<uint32_t>(format) || header.SampleRate == 0 || header.Channels == 0 || header.Channels > 2 ||
+            header.DataSize % GetBlockSize(format, header.Channels) != 0 || header.PaddingFrames >= GetBlockFrames(format) ||
+            header.DataSize != file->GetSize() - sizeof(PcmCacheHeader))
+            return false;
+
+        audio.Samples = {};
+        audio.CachedFile = std::move(file);
+        audio.CachedOffset = sizeof(PcmCacheHeader);
+        audio.SampleRate = header.SampleRate;
+        audio.Channels = header.Channels;
+        audio.Format = format;
+        audio.PaddingFrames = header.PaddingFrames;
+        return true;
+    }
+
+    void StoreCachedPcm(const std::string& filename, const DecodedAudio& audio)
+    {
+        if (s_CacheDirectory.empty() || audio.CachedFile)
+            return;
+
+        SourceFileInfo info;
+        if (!GetSourceFileInfo(filename, info))
+            return;
+
+        PcmCacheHeader header{};
+        memcpy(header.Magic, PcmCacheMagic, sizeof(PcmCacheMagic));
+        header.Version = PcmCacheVersion;
+        header.SourceSize = info.Size;
+        header.SourceTime = info.Time;
+        header.PathHash = info.PathHash;
+        header.SampleRate = audio.SampleRate;
+        header.Channels = audio.Channels;
+        header.Format = static_cast<uint32_t>(audio.Format);
+        header.PaddingFrames = audio.PaddingFrames;
+        header.DataSize = audio.GetSize();
+
+        WriteCacheFile(GetCacheFilename(info, audio.Format), &header, sizeof(header), audio.GetData(), audio.GetSize());
+    }
+
+    std::shared_ptr<const Mp3SeekIndex> LoadCachedSeekIndex(const std::string& filename)
+    {
+        if (s_CacheDirectory.empty())
+            return nullptr;
+
+        SourceFileInfo info;
+        if (!GetSourceFileInfo(filename, info))
+            return nullptr;
+
+        MappedFile file;
+        if (!file.Open(GetSeekIndexFilename(info).string()) || file.GetSize() < sizeof(SeekIndexHeader))
+            return nullptr;
+
+        SeekIndexHeader header;
+        memcpy(&header, file.GetData(), sizeof(header));
+
+        if (memcmp(header.Magic, SeekIndexMagic, sizeof(SeekIndexMagic)) != 0 || header.Version != SeekIndexVersion ||
+            header.SourceSize != info.Size || header.SourceTime != info.Time || header.PathHash != info.PathHash ||
+            header.Samples == 0 || header.FrameCount == 0 ||
+            header.FrameCount * sizeof(Mp3SeekIndex::Frame) != file.GetSize() - sizeof(SeekIndexHeader))
+            return nullptr;
+
+        auto index = std::make_shared<Mp3SeekIndex>();
+        index->Frames.resize(header.FrameCount);
+        memcpy(index->Frames.data(), file.GetData() + sizeof(SeekIndexHeader), header.FrameCount * sizeof(Mp3SeekIndex::Frame));
+        index->Samples = header.Samples;
+
+        // minimp3 reads wherever the index points, so a damaged entry must not point outside the file
+        for (const auto& frame : index->Frames)
+        {
+            if (frame.Offset >= info.Size || frame.Sample > index->Samples)
+                return nullptr;
+        }
+        return index;
+    }
+
+    void StoreCachedSeekIndex(const std::string& filename, const Mp3SeekIndex& index)
+    {
+        if (s_CacheDirectory.empty() || index.Frames.empty())
+            return;
+
+        SourceFileInfo info;
+        if (!GetSourceFileInfo(filename, info))
+            return;
+
+        SeekIndexHeader header{};
+        memcpy(header.Magic, SeekIndexMagic, sizeof(SeekIndexMagic));
+        header.Version = SeekIndexVersion;
+        header.SourceSize = info.Size;
+        header.SourceTime = info.Time;
+        header.PathHash = info.PathHash;
+        header.Samples = index.Samples;
+        header.FrameCount = index.Frames.size();
+
+        WriteCacheFile(GetSeekIndexFilename(info), &header, sizeof(header), index.Frames.data(),
+                       index.Frames.size() * sizeof(Mp3SeekIndex::Frame));
+    }
+} // namespace Hazel::Audio
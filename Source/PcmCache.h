@@ -0,0 +1,23 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "HazelAudio/HazelAudio.h"
+
+namespace Hazel::Audio
+{
+    struct DecodedAudio;
+    struct Mp3SeekIndex;
+
+    // Empty disables the cache
+    void SetPcmCacheDirectory(const std::string& directory);
+
+    // Maps the cached PCM for a file into audio if there's an entry in that format matching the file's current size and mtime
+    bool LoadCachedPcm(const std::string& filename, SampleFormat format, DecodedAudio& audio);
+    void StoreCachedPcm(const std::string& filename, const DecodedAudio& audio);
+
+    // MP3 seek indices live in the same directory, so streamed and compressed clips skip the scan on the next run
+    std::shared_ptr<const Mp3SeekIndex> LoadCachedSeekIndex(const std::string& filename);
+    void StoreCachedSeekIndex(const std::string& filename, const Mp3SeekIndex& index);
+} // namespace Hazel::Audio
@@ -0,0 +1,63 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+namespace Hazel::Audio
+{
+    ThreadPool::ThreadPool(uint32_t threadCount)
+    {
+        if (threadCount == 0)
+            threadCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+
+        mThreads.reserve(threadCount);
+        for (uint32_t i = 0; i < threadCount; i++)
+            mThreads.emplace_back([this] { WorkerLoop(); });
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard lock(mMutex);
+            mRunning = false;
+            mJobs.clear();
+        }
+
+        mCondition.notify_all();
+        for (auto& thread : mThreads)
+            thread.join();
+    }
+
+    void ThreadPool::Enqueue(std::function<void()> job)
+    {
+        {
+            std::lock_guard lock(mMutex);
+            mJobs.push_back(std::move(job));
+        }
+
+        mCondition.notify_one();
+    }
+
+    uint32_t ThreadPool::GetThreadCount() const
+    {
+        return static_cast<uint32_t>(mThreads.size());
+    }
+
+    void ThreadPool::WorkerLoop()
+    {
+        while (true)
+        {
+            std::function<void()> job;
+            {
+                std::unique_lock lock(mMutex);
+                mCondition.wait(lock, [this] { return !mRunning || !mJobs.empty(); });
+                if (!mRunning)
+                    return;
+
+                job = std::move(mJobs.front());
+                mJobs.pop_front();
+            }
+
+            job();
+        }
+    }
+} // namespace Hazel::Audio
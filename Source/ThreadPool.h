@@ -0,0 +1,36 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Hazel::Audio
+{
+    // Fixed set of worker threads running queued jobs in FIFO order
+    class ThreadPool
+    {
+    public:
+        // 0 picks one thread per hardware thread, minus the caller's
+        explicit ThreadPool(uint32_t threadCount = 0);
+        ThreadPool(const ThreadPool&) = delete;
+        // Jobs that haven't started yet are dropped, running ones are waited for
+        ~ThreadPool();
+
+        void Enqueue(std::function<void()> job);
+
+        [[nodiscard]] uint32_t GetThreadCount() const;
+
+    private:
+        void WorkerLoop();
+
+        std::vector<std::thread> mThreads;
+        std::deque<std::function<void()>> mJobs;
+        std::mutex mMutex;
+        std::condition_variable mCondition;
+        bool mRunning{true};
+    };
+} // namespace Hazel::Audio
@@ -0,0 +1,780 @@
+#include "VoiceManager.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "MixerBus.h"
+
+namespace Hazel::Audio
+{
+    struct VoiceSlot
+    {
+        uint32_t Dense{};       // index into s_Voices
+        uint32_t Generation{1}; // bumped whenever the slot is freed, 0 is never valid
+    };
+
+    // Live voices are packed so the per frame passes walk contiguous memory, handles go through
+    // s_Slots which never moves. Destroying a voice moves the last one into its place
+    static std::vector<VoiceState> s_Voices;
+    static std::vector<VoiceSlot> s_Slots;
+    static std::vector<uint32_t> s_FreeSlots;
+
+    // All AL sources are created in InitVoices, at most s_MaxVoices are ever bound
+    static std::vector<uint32_t> s_FreeSources;
+    static uint32_t s_MaxVoices{};
+    static uint32_t s_BoundVoices{};
+
+    // Indexed by category, categories past the end of s_CategoryBudgets are unlimited
+    static std::vector<uint32_t> s_CategoryBudgets;
+    static std::vector<uint32_t> s_CategoryBoundVoices;
+    static std::vector<uint32_t> s_CategoryWantedVoices; // reused by UpdateVoices
+
+    static std::chrono::steady_clock::time_point s_LastUpdate; // unset until the first UpdateVoices
+    static std::vector<VoiceState*> s_Candidates; // reused by UpdateVoices
+    static std::vector<std::function<void()>> s_FinishedCallbacks;
+
+    struct ScheduledGroup
+    {
+        uint64_t StartTime{}; // device clock, in nanoseconds
+        std::vector<SourceHandle> Voices;
+    };
+
+    static std::vector<ScheduledGroup> s_ScheduledGroups;
+    static std::vector<VoiceState*> s_GroupVoices; // reused when starting scheduled groups
+    static std::vector<uint32_t> s_GroupSources;   // reused by PlayVoices
+
+    // Lets the AL event thread find the voice a source is bound to. Also held
+    // whenever voices move, since the event thread writes to them
+    static std::mutex s_EventMutex;
+    static std::unordered_map<uint32_t, uint32_t> s_SourceSlots;
+
+    static void AL_APIENTRY OnSourceEvent(ALenum eventType, ALuint object, ALuint param, ALsizei, const ALchar*, void*)
+    {
+        if (eventType != AL_EVENT_TYPE_SOURCE_STATE_CHANGED_SOFT || param != AL_STOPPED)
+            return;
+
+        std::lock_guard lock(s_EventMutex);
+        if (const auto it = s_SourceSlots.find(object); it != s_SourceSlots.end())
+            s_Voices[s_Slots[it->second].Dense].StopEvent.store(true, std::memory_order_release);
+    }
+
+    static uint32_t AcquireSource()
+    {
+        if (s_FreeSources.empty())
+            return 0;
+
+        const uint32_t source = s_FreeSources.back();
+        s_FreeSources.pop_back();
+        return source;
+    }
+
+    static void ReleaseSource(uint32_t source)
+    {
+        // Reset everything a voice touches so the next user starts clean
+        constexpr ALfloat zero[] = {0.0f, 0.0f, 0.0f};
+        alSourceStop(source);
+        alSourcei(source, AL_BUFFER, 0);
+        alSourcefv(source, AL_POSITION, zero);
+        alSourcefv(source, AL_VELOCITY, zero);
+        alSourcef(source, AL_GAIN, 1.0f);
+        alSourcef(source, AL_PITCH, 1.0f);
+        alSourcei(source, AL_LOOPING, AL_FALSE);
+        alSourcei(source, AL_SOURCE_SPATIALIZE_SOFT, AL_AUTO_SOFT);
+
+        s_FreeSources.push_back(source);
+    }
+
+    // What actually goes into AL_GAIN
+    static float GetEffectiveGain(const VoiceState& voice)
+    {
+        return voice.Gain * voice.Volume * GetBusGain(voice.Bus);
+    }
+
+    // Compressed clips play through a streamer as well, they just read from memory
+    static bool IsStreamed(const VoiceState& voice)
+    {
+        return voice.Clip && voice.Clip->GetStorage() != ClipStorage::Decoded;
+    }
+
+    static uint32_t GetCategoryBudget(uint32_t category)
+    {
+        if (category < s_CategoryBudgets.size())
+            return s_CategoryBudgets[category];
+        return std::numeric_limits<uint32_t>::max();
+    }
+
+    static uint32_t& GetCategoryBoundVoices(uint32_t category)
+    {
+        if (category >= s_CategoryBoundVoices.size())
+            s_CategoryBoundVoices.resize(category + 1);
+        return s_CategoryBoundVoices[category];
+    }
+
+    static bool IsCategoryFull(uint32_t category)
+    {
+        return GetCategoryBoundVoices(category) >= GetCategoryBudget(category);
+    }
+
+    bool BindVoice(VoiceState& voice)
+    {
+        if (voice.SourceHandle)
+            return true;
+        if (!voice.Clip || s_BoundVoices >= s_MaxVoices || IsCategoryFull(voice.Category))
+            return false;
+
+        const uint32_t source = AcquireSource();
+        if (!source)
+            return false;
+
+        alSourcefv(source, AL_POSITION, voice.Position);
+        alSourcefv(source, AL_VELOCITY, voice.Velocity);
+        alSourcef(source, AL_GAIN, GetEffectiveGain(voice));
+        alSourcef(source, AL_PITCH, voice.Pitch);
+        alSourcei(source, AL_SOURCE_SPATIALIZE_SOFT, voice.Spatialize);
+
+        if (IsStreamed(voice))
+        {
+            auto decoder = voice.Clip->OpenDecoder();
+            if (!decoder)
+            {
+                // Not going to get any better by retrying every Update
+                ReleaseSource(source);
+                voice.State = PlayState::Stopped;
+                return false;
+            }
+
+            // Looping is done by rewinding the decoder, AL_LOOPING would replay the queue
+            voice.Streamer = std::make_unique<AudioStreamer>(source, std::move(decoder), voice.Clip->GetSampleFormat());
+            if (!voice.Streamer->IsValid())
+            {
+                // Stays virtual, buffers may free up by the next Update
+                voice.Streamer.reset();
+                ReleaseSource(source);
+                return false;
+            }
+            voice.Streamer->SetLoop(voice.Loop);
+        }
+        else
+        {
+            alSourcei(source, AL_BUFFER, static_cast<int>(voice.Clip->GetBufferHandle()));
+            alSourcei(source, AL_LOOPING, voice.Loop ? AL_TRUE : AL_FALSE);
+            alSourcef(source, AL_SEC_OFFSET, voice.PlaybackPosition);
+        }
+
+        voice.SourceHandle = source;
+        s_BoundVoices++;
+        GetCategoryBoundVoices(voice.Category)++;
+
+        std::lock_guard lock(s_EventMutex);
+        s_SourceSlots[source] = voice.Slot;
+        return true;
+    }
+
+    static void Unbind(VoiceState& voice)
+    {
+        if (!voice.SourceHandle)
+            return;
+
+        if (voice.Streamer)
+        {
+            // Picks up from here if it gets a source back
+            if (voice.State == PlayState::Playing)
+                voice.PlaybackPosition = GetVoicePlaybackPosition(voice);
+            voice.Streamer.reset();
+        }
+        else if (voice.State == PlayState::Playing || voice.State == PlayState::Paused)
+        {
+            ALfloat offset{};
+            alGetSourcef(voice.SourceHandle, AL_SEC_OFFSET, &offset);
+            voice.PlaybackPosition = offset;
+        }
+
+        {
+            std::lock_guard lock(s_EventMutex);
+            s_SourceSlots.erase(voice.SourceHandle);
+        }
+        voice.StopEvent = false;
+
+        // The source must let go of the buffer before the clip can be deleted
+        ReleaseSource(voice.SourceHandle);
+        voice.SourceHandle = 0;
+        s_BoundVoices--;
+        GetCategoryBoundVoices(voice.Category)--;
+    }
+
+    static uint64_t GetStartFrame(const VoiceState& voice)
+    {
+        return static_cast<uint64_t>(static_cast<double>(voice.PlaybackPosition) * voice.Clip->GetSampleRate());
+    }
+
+    static void StartBound(VoiceState& voice)
+    {
+        voice.StopEvent = false;
+        if (voice.Streamer)
+            voice.Streamer->Play(GetStartFrame(voice));
+        else
+            alSourcePlay(voice.SourceHandle);
+    }
+
+    static void Finish(VoiceState& voice)
+    {
+        if (voice.OnFinished)
+            s_FinishedCallbacks.push_back(voice.OnFinished);
+
+        voice.State = PlayState::Stopped;
+        voice.PlaybackPosition = 0.0f;
+        Unbind(voice);
+
+        if (voice.OneShot)
+            DestroyVoice(voice);
+    }
+
+    // Stop events can be stale, e.g. from before the source was restarted or handed to this
+    // voice, so one is confirmed with the source before it's believed
+    static bool HasStopped(VoiceState& voice)
+    {
+        if (!voice.StopEvent.exchange(false, std::memory_order_acquire))
+            return false;
+
+        ALenum state;
+        alGetSourcei(voice.SourceHandle, AL_SOURCE_STATE, &state);
+        if (state != AL_STOPPED)
+            return false;
+
+        // Leave it set for UpdateVoices, which does the actual transition
+        voice.StopEvent.store(true, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Returns true once a voice played to its end. Bound voices find out from the mixer and virtual
+    // ones from the clock, whose estimate also covers for a stop event the mixer had to drop
+    static bool AdvanceVoice(VoiceState& voice, float deltaTime)
+    {
+        // Streams decode wherever the clock says once they get a source back
+        if (voice.Streamer)
+            return voice.Streamer->IsFinished();
+
+        const float duration = voice.Clip->GetDuration();
+        voice.PlaybackPosition += deltaTime * voice.Pitch;
+        if (voice.PlaybackPosition >= duration)
+        {
+            if (voice.Loop && duration > 0.0f)
+                voice.PlaybackPosition = std::fmod(voice.PlaybackPosition, duration);
+            else if (!voice.SourceHandle)
+                return true;
+            else
+                voice.StopEvent = true;
+        }
+
+        return voice.SourceHandle && HasStopped(voice);
+    }
+
+    static float GetAudibility(const VoiceState& voice, const float* listener)
+    {
+        const bool spatial = voice.Spatialize == AL_TRUE || (voice.Spatialize == AL_AUTO_SOFT && voice.Clip->GetChannels() == 1);
+        if (!spatial)
+            return GetEffectiveGain(voice);
+
+        // AL_INVERSE_DISTANCE_CLAMPED with the default reference distance and rolloff of 1
+        const float dx = voice.Position[0] - listener[0];
+        const float dy = voice.Position[1] - listener[1];
+        const float dz = voice.Position[2] - listener[2];
+        const float distance = std::max(std::sqrt(dx * dx + dy * dy + dz * dz), 1.0f);
+        return GetEffectiveGain(voice) / distance;
+    }
+
+    // Paused voices come last since they aren't heard at all. Otherwise priority wins,
+    // audibility only breaks ties
+    static bool IsMoreAudible(const VoiceState& a, const VoiceState& b)
+    {
+        const bool aPlaying = a.State == PlayState::Playing;
+        const bool bPlaying = b.State == PlayState::Playing;
+        if (aPlaying != bPlaying)
+            return aPlaying;
+
+        if (a.Priority != b.Priority)
+            return a.Priority > b.Priority;
+        return a.Audibility > b.Audibility;
+    }
+
+    // Under pressure the least audible bound voice gives up its source if the new voice beats it.
+    // It carries on virtually like any other voice that lost out in UpdateVoices
+    static bool StealSource(VoiceState& voice)
+    {
+        float listener[3];
+        alGetListenerfv(AL_POSITION, listener);
+        voice.Audibility = GetAudibility(voice, listener);
+
+        // With only the category full, the victim has to come from the same category
+        const bool sameCategory = IsCategoryFull(voice.Category);
+
+        VoiceState* victim{};
+        for (VoiceState& other : s_Voices)
+        {
+            if (!other.SourceHandle || (sameCategory && other.Category != voice.Category))
+                continue;
+
+            other.Audibility = GetAudibility(other, listener);
+            if (!victim || IsMoreAudible(*victim, other))
+                victim = &other;
+        }
+
+        if (!victim || !IsMoreAudible(voice, *victim))
+            return false;
+
+        Unbind(*victim);
+        return BindVoice(voice);
+    }
+
+    void InitVoices(uint32_t maxVoices)
+    {
+        s_FreeSources.resize(maxVoices);
+        alGetError(); // clear whatever error was left over
+        alGenSources(static_cast<ALsizei>(maxVoices), s_FreeSources.data());
+        if (alGetError() != AL_NO_ERROR)
+        {
+            // More than the device allows, take as many as it has one at a time
+            s_FreeSources.clear();
+            uint32_t source{};
+            while (s_FreeSources.size() < maxVoices && (alGenSources(1, &source), alGetError() == AL_NO_ERROR))
+                s_FreeSources.push_back(source);
+        }
+        s_MaxVoices = static_cast<uint32_t>(s_FreeSources.size());
+        s_LastUpdate = {};
+
+        // Finished sources are reported by the mixer instead of being polled
+        constexpr ALenum events[] = {AL_EVENT_TYPE_SOURCE_STATE_CHANGED_SOFT};
+        alEventCallbackSOFT(OnSourceEvent, nullptr);
+        alEventControlSOFT(1, events, AL_TRUE);
+    }
+
+    void ShutdownVoices()
+    {
+        // Backwards, destroying a voice moves the last one into its place
+        for (size_t i = s_Voices.size(); i-- > 0;)
+        {
+            if (s_Voices[i].OneShot)
+                DestroyVoice(s_Voices[i]);
+            else
+                Unbind(s_Voices[i]);
+        }
+
+        s_ScheduledGroups.clear();
+        alEventCallbackSOFT(nullptr, nullptr);
+        alDeleteSources(static_cast<ALsizei>(s_FreeSources.size()), s_FreeSources.data());
+        s_FreeSources.clear();
+    }
+
+    static void StartScheduledGroups()
+    {
+        const uint64_t clock = GetDeviceClock();
+        for (size_t i = s_ScheduledGroups.size(); i-- > 0;)
+        {
+            if (s_ScheduledGroups[i].StartTime > clock)
+                continue;
+
+            // Voices destroyed in the meantime are simply left out
+            s_GroupVoices.clear();
+            for (const SourceHandle handle : s_ScheduledGroups[i].Voices)
+            {
+                if (VoiceState* voice = GetVoice(handle))
+                    s_GroupVoices.push_back(voice);
+            }
+            PlayVoices(s_GroupVoices.data(), s_GroupVoices.size());
+
+            s_ScheduledGroups[i] = std::move(s_ScheduledGroups.back());
+            s_ScheduledGroups.pop_back();
+        }
+    }
+
+    void UpdateVoices()
+    {
+        const auto now = std::chrono::steady_clock::now();
+        // The clock starts with the first update, whatever was loaded in between Init and that isn't played through
+        const bool firstUpdate = s_LastUpdate == std::chrono::steady_clock::time_point{};
+        const float deltaTime = firstUpdate ? 0.0f : std::chrono::duration<float>(now - s_LastUpdate).count();
+        s_LastUpdate = now;
+
+        float listener[3];
+        alGetListenerfv(AL_POSITION, listener);
+
+        // A bus volume change is a single pass here no matter how many voices it affects,
+        // and it's part of the deferred batch Update() wraps this in
+        if (UpdateBusGains())
+        {
+            for (const VoiceState& voice : s_Voices)
+            {
+                if (voice.SourceHandle && IsBusGainChanged(voice.Bus))
+                    alSourcef(voice.SourceHandle, AL_GAIN, GetEffectiveGain(voice));
+            }
+        }
+
+        // Backwards, finished one-shots are destroyed which moves the last voice into their place
+        for (size_t i = s_Voices.size(); i-- > 0;)
+        {
+            VoiceState& voice = s_Voices[i];
+            if (voice.State == PlayState::Playing && AdvanceVoice(voice, deltaTime))
+                Finish(voice);
+        }
+
+        // Nothing moves from here on until the callbacks run
+        s_Candidates.clear();
+        for (VoiceState& voice : s_Voices)
+        {
+            if (voice.State != PlayState::Playing && voice.State != PlayState::Paused)
+                continue;
+
+            voice.Audibility = GetAudibility(voice, listener);
+            s_Candidates.push_back(&voice);
+        }
+
+        std::sort(s_Candidates.begin(), s_Candidates.end(),
+                  [](const VoiceState* a, const VoiceState* b) { return IsMoreAudible(*a, *b); });
+
+        // Hand out sources in order until the global limit or the voice's category budget runs out
+        uint32_t wantedVoices{};
+        s_CategoryWantedVoices.assign(s_CategoryBudgets.size(), 0);
+        for (VoiceState* voice : s_Candidates)
+        {
+            const bool categoryFull = voice->Category < s_CategoryBudgets.size() &&
+                                      s_CategoryWantedVoices[voice->Category] >= s_CategoryBudgets[voice->Category];
+            voice->WantsSource = wantedVoices < s_MaxVoices && !categoryFull;
+            if (!voice->WantsSource)
+                continue;
+
+            wantedVoices++;
+            if (voice->Category < s_CategoryBudgets.size())
+                s_CategoryWantedVoices[voice->Category]++;
+        }
+
+        // Free up sources first so the loudest voices can take them over
+        for (VoiceState* voice : s_Candidates)
+        {
+            if (!voice->WantsSource)
+                Unbind(*voice);
+        }
+
+        for (VoiceState* voice : s_Candidates)
+        {
+            if (!voice->WantsSource || voice->SourceHandle || voice->State != PlayState::Playing)
+                continue;
+
+            if (BindVoice(*voice))
+                StartBound(*voice);
+        }
+
+        if (!s_ScheduledGroups.empty())
+            StartScheduledGroups();
+
+        // Last, callbacks are free to start, stop or destroy anything
+        for (size_t i = 0; i < s_FinishedCallbacks.size(); i++)
+            s_FinishedCallbacks[i]();
+        s_FinishedCallbacks.clear();
+    }
+
+    SourceHandle CreateVoice()
+    {
+        std::lock_guard lock(s_EventMutex);
+
+        uint32_t slot;
+        if (!s_FreeSlots.empty())
+        {
+            slot = s_FreeSlots.back();
+            s_FreeSlots.pop_back();
+        }
+        else
+        {
+            slot = static_cast<uint32_t>(s_Slots.size());
+            s_Slots.emplace_back();
+        }
+
+        s_Slots[slot].Dense = static_cast<uint32_t>(s_Voices.size());
+        s_Voices.emplace_back().Slot = slot;
+        return {slot, s_Slots[slot].Generation};
+    }
+
+    void DestroyVoice(VoiceState& voice)
+    {
+        Unbind(voice);
+
+        std::lock_guard lock(s_EventMutex);
+
+        const uint32_t slot = voice.Slot;
+        const uint32_t dense = s_Slots[slot].Dense;
+        if (++s_Slots[slot].Generation == 0)
+            s_Slots[slot].Generation = 1;
+        s_FreeSlots.push_back(slot);
+
+        if (dense + 1 < s_Voices.size())
+        {
+            voice = std::move(s_Voices.back());
+            s_Slots[voice.Slot].Dense = dense;
+        }
+        s_Voices.pop_back();
+    }
+
+    VoiceState* GetVoice(SourceHandle handle)
+    {
+        if (handle.Index >= s_Slots.size() || handle.Generation != s_Slots[handle.Index].Generation)
+            return nullptr;
+        return &s_Voices[s_Slots[handle.Index].Dense];
+    }
+
+    SourceHandle GetVoiceHandle(const VoiceState& voice)
+    {
+        return {voice.Slot, s_Slots[voice.Slot].Generation};
+    }
+
+    void SetVoiceClip(VoiceState& voice, std::shared_ptr<AudioClip> clip)
+    {
+        StopVoice(voice);
+        voice.Clip = std::move(clip);
+        voice.State = PlayState::Initial;
+        voice.PlaybackPosition = 0.0f;
+    }
+
+    void PlayVoice(VoiceState& voice)
+    {
+        if (!voice.Clip)
+            return;
+
+        // Paused voices resume and stopped ones start from wherever they were seeked to
+        if (voice.State == PlayState::Playing)
+            voice.PlaybackPosition = 0.0f;
+        voice.State = PlayState::Playing;
+
+        // Without a source to spare it starts out virtual, Update binds it if it's loud enough
+        if (BindVoice(voice) || StealSource(voice))
+            StartBound(voice);
+    }
+
+    void PlayVoices(VoiceState* const* voices, size_t count)
+    {
+        // Bind everything before collecting sources, a later voice may steal from an earlier one
+        for (size_t i = 0; i < count; i++)
+        {
+            VoiceState& voice = *voices[i];
+            if (!voice.Clip)
+                continue;
+
+            if (voice.State == PlayState::Playing)
+                voice.PlaybackPosition = 0.0f;
+            voice.State = PlayState::Playing;
+
+            if (!BindVoice(voice))
+                StealSource(voice);
+        }
+
+        s_GroupSources.clear();
+        for (size_t i = 0; i < count; i++)
+        {
+            VoiceState& voice = *voices[i];
+            if (!voice.Clip || !voice.SourceHandle)
+                continue;
+
+            voice.StopEvent = false;
+            if (voice.Streamer)
+                voice.Streamer->Prepare(GetStartFrame(voice));
+            s_GroupSources.push_back(voice.SourceHandle);
+        }
+
+        alSourcePlayv(static_cast<ALsizei>(s_GroupSources.size()), s_GroupSources.data());
+
+        for (size_t i = 0; i < count; i++)
+        {
+            if (voices[i]->Streamer)
+                voices[i]->Streamer->Started();
+        }
+    }
+
+    void ScheduleVoices(std::vector<SourceHandle> handles, uint64_t startTime)
+    {
+        s_ScheduledGroups.push_back({startTime, std::move(handles)});
+    }
+
+    void PauseVoice(VoiceState& voice)
+    {
+        if (voice.State != PlayState::Playing)
+            return;
+
+        voice.PlaybackPosition = GetVoicePlaybackPosition(voice);
+        voice.State = PlayState::Paused;
+        if (voice.Streamer)
+            voice.Streamer->Pause();
+        else if (voice.SourceHandle)
+            alSourcePause(voice.SourceHandle);
+    }
+
+    void StopVoice(VoiceState& voice)
+    {
+        if (voice.State == PlayState::Initial)
+            return;
+
+        voice.State = PlayState::Stopped;
+        voice.PlaybackPosition = 0.0f;
+        Unbind(voice);
+    }
+
+    void SeekVoice(VoiceState& voice, float seconds)
+    {
+        if (!voice.Clip)
+            return;
+
+        const float duration = voice.Clip->GetDuration();
+        voice.PlaybackPosition = std::clamp(seconds, 0.0f, duration);
+
+        if (voice.Streamer)
+        {
+            voice.Streamer->Seek(GetStartFrame(voice));
+        }
+        else if (voice.SourceHandle)
+        {
+            // AL_SEC_OFFSET has to stay inside the buffer, the end itself is rejected
+            const float lastFrame = duration - 1.0f / static_cast<float>(voice.Clip->GetSampleRate());
+            alSourcef(voice.SourceHandle, AL_SEC_OFFSET, std::clamp(voice.PlaybackPosition, 0.0f, std::max(lastFrame, 0.0f)));
+        }
+    }
+
+    float GetVoicePlaybackPosition(const VoiceState& voice)
+    {
+        if (voice.State != PlayState::Playing && voice.State != PlayState::Paused)
+            return voice.PlaybackPosition;
+
+        if (voice.Streamer)
+        {
+            // Paused streams took their position along when they paused
+            if (voice.State == PlayState::Paused)
+                return voice.PlaybackPosition;
+            return static_cast<float>(static_cast<double>(voice.Streamer->GetPlaybackFrame()) / voice.Clip->GetSampleRate());
+        }
+
+        if (voice.SourceHandle)
+        {
+            ALfloat offset{};
+            alGetSourcef(voice.SourceHandle, AL_SEC_OFFSET, &offset);
+            return offset;
+        }
+        return voice.PlaybackPosition;
+    }
+
+    // Unchanged values are skipped so setting every emitter every frame only costs the ones that moved
+    void SetVoicePosition(VoiceState& voice, float x, float y, float z)
+    {
+        if (voice.Position[0] == x && voice.Position[1] == y && voice.Position[2] == z)
+            return;
+
+        voice.Position[0] = x;
+        voice.Position[1] = y;
+        voice.Position[2] = z;
+
+        if (voice.SourceHandle)
+            alSourcefv(voice.SourceHandle, AL_POSITION, voice.Position);
+    }
+
+    void SetVoiceVelocity(VoiceState& voice, float x, float y, float z)
+    {
+        if (voice.Velocity[0] == x && voice.Velocity[1] == y && voice.Velocity[2] == z)
+            return;
+
+        voice.Velocity[0] = x;
+        voice.Velocity[1] = y;
+        voice.Velocity[2] = z;
+
+        if (voice.SourceHandle)
+            alSourcefv(voice.SourceHandle, AL_VELOCITY, voice.Velocity);
+    }
+
+    void SetVoiceGain(VoiceState& voice, float gain)
+    {
+        if (voice.Gain == gain)
+            return;
+
+        voice.Gain = gain;
+
+        if (voice.SourceHandle)
+            alSourcef(voice.SourceHandle, AL_GAIN, GetEffectiveGain(voice));
+    }
+
+    void SetVoiceVolume(VoiceState& voice, float volume)
+    {
+        if (voice.Volume == volume)
+            return;
+
+        voice.Volume = volume;
+
+        if (voice.SourceHandle)
+            alSourcef(voice.SourceHandle, AL_GAIN, GetEffectiveGain(voice));
+    }
+
+    void SetVoiceBus(VoiceState& voice, BusHandle bus)
+    {
+        if (voice.Bus == bus || !IsValidBus(bus))
+            return;
+
+        voice.Bus = bus;
+
+        if (voice.SourceHandle)
+            alSourcef(voice.SourceHandle, AL_GAIN, GetEffectiveGain(voice));
+    }
+
+    void SetVoicePitch(VoiceState& voice, float pitch)
+    {
+        voice.Pitch = pitch;
+
+        if (voice.SourceHandle)
+            alSourcef(voice.SourceHandle, AL_PITCH, pitch);
+    }
+
+    void SetVoiceSpatialize(VoiceState& voice, int spatialize)
+    {
+        voice.Spatialize = spatialize;
+
+        if (voice.SourceHandle)
+            alSourcei(voice.SourceHandle, AL_SOURCE_SPATIALIZE_SOFT, spatialize);
+    }
+
+    void SetVoiceLoop(VoiceState& voice, bool loop)
+    {
+        voice.Loop = loop;
+
+        if (voice.Streamer)
+            voice.Streamer->SetLoop(loop);
+        else if (voice.SourceHandle)
+            alSourcei(voice.SourceHandle, AL_LOOPING, loop ? AL_TRUE : AL_FALSE);
+    }
+
+    void SetVoiceCategory(VoiceState& voice, uint32_t category)
+    {
+        // Budgets are enforced again in the next Update
+        if (voice.SourceHandle)
+        {
+            GetCategoryBoundVoices(voice.Category)--;
+            GetCategoryBoundVoices(category)++;
+        }
+        voice.Category = category;
+    }
+
+    PlayState GetVoiceState(VoiceState& voice)
+    {
+        // The transition itself and OnFinished are left to UpdateVoices
+        if (voice.State == PlayState::Playing && voice.SourceHandle)
+        {
+            const bool finished = voice.Streamer ? voice.Streamer->IsFinished() : HasStopped(voice);
+            if (finished)
+                return PlayState::Stopped;
+        }
+        return voice.State;
+    }
+
+    void SetCategoryVoiceBudget(uint32_t category, uint32_t maxVoices)
+    {
+        if (category >= s_CategoryBudgets.size())
+            s_CategoryBudgets.resize(category + 1, std::numeric_limits<uint32_t>::max());
+        s_CategoryBudgets[category] = maxVoices;
+    }
+} // namespace Hazel::Audio
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "HazelAudio/HazelAudio.h"
+#include "alext.h"
+#include "AudioStreamer.h"
+
+namespace Hazel::Audio
+{
+    enum class PlayState
+    {
+        Initial = 0,
+        Playing,
+        Paused,
+        Stopped
+    };
+
+    // std::atomic<bool> that moves along with its voice, voices only move with the event mutex held
+    struct MovableFlag : std::atomic<bool>
+    {
+        MovableFlag() noexcept : std::atomic<bool>(false)
+        {
+        }
+        MovableFlag(MovableFlag&& other) noexcept : std::atomic<bool>(other.load(std::memory_order_relaxed))
+        {
+        }
+        MovableFlag& operator=(MovableFlag&& other) noexcept
+        {
+            store(other.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            return *this;
+        }
+        using std::atomic<bool>::operator=;
+    };
+
+    // A logical voice, what Source and PlayOneShot actually play through. Every
+    // attribute lives here so the voice can lose its AL source while it's inaudible
+    // and pick up where it would have been once it gets one back
+    struct VoiceState
+    {
+        std::shared_ptr<AudioClip> Clip;
+        std::unique_ptr<AudioStreamer> Streamer; // only while a streamed clip is bound
+        uint32_t SourceHandle{};                 // 0 while the voice is virtual
+        uint32_t Slot{};                         // where the voice's handle points, fixed up when it moves
+        PlayState State{PlayState::Initial};
+        float PlaybackPosition{}; // in seconds, exact while virtual and estimated while bound, where Play starts unless it's playing
+        // Set from the AL event thread when the bound source reports AL_STOPPED
+        MovableFlag StopEvent;
+        std::function<void()> OnFinished;
+
+        float Position[3]{};
+        float Velocity[3]{};
+        float Gain{1.0f};
+        float Volume{1.0f}; // separate multiplier on top of Gain
+        BusHandle Bus{MasterBus};
+        float Pitch{1.0f};
+        int Spatialize{AL_AUTO_SOFT}; // AL_TRUE, AL_FALSE or AL_AUTO_SOFT
+        bool Loop{};
+        bool OneShot{}; // freed as soon as it finishes
+
+        int Priority{};
+        uint32_t Category{};
+        float Audibility{}; // effective gain after distance attenuation, refreshed by UpdateVoices
+        bool WantsSource{}; // scratch for UpdateVoices
+    };
+
+    void InitVoices(uint32_t maxVoices);
+    void ShutdownVoices();
+    // Advances virtual voices, recycles finished ones and rebinds AL sources to the most audible voices
+    void UpdateVoices();
+
+    // Gives the voice an AL source set up to continue from PlaybackPosition, doesn't start it.
+    // Fails when MaxVoices sources or the voice's category budget are already used up
+    bool BindVoice(VoiceState& voice);
+
+    // Voices are packed densely and move around as others are destroyed, so VoiceState
+    // pointers are only good until the next CreateVoice or DestroyVoice
+    SourceHandle CreateVoice();
+    void DestroyVoice(VoiceState& voice);
+    // nullptr for stale handles
+    VoiceState* GetVoice(SourceHandle handle);
+    SourceHandle GetVoiceHandle(const VoiceState& voice);
+
+    void SetVoiceClip(VoiceState& voice, std::shared_ptr<AudioClip> clip);
+    void PlayVoice(VoiceState& voice);
+    // Starts every voice that gets an AL source with a single alSourcePlayv, so they start on the same sample
+    void PlayVoices(VoiceState* const* voices, size_t count);
+    // PlayVoices once the device clock reaches startTime, checked at the end of each UpdateVoices
+    void ScheduleVoices(std::vector<SourceHandle> handles, uint64_t startTime);
+    void PauseVoice(VoiceState& voice);
+    void StopVoice(VoiceState& voice);
+    // Clamped to the clip. A voice that isn't playing starts from there the next time it plays
+    void SeekVoice(VoiceState& voice, float seconds);
+    // In seconds, read back from the AL source or the stream while the voice has one
+    float GetVoicePlaybackPosition(const VoiceState& voice);
+
+    void SetVoicePosition(VoiceState& voice, float x, float y, float z);
+    void SetVoiceVelocity(VoiceState& voice, float x, float y, float z);
+    void SetVoiceGain(VoiceState& voice, float gain);
+    void SetVoiceVolume(VoiceState& voice, float volume);
+    void SetVoiceBus(VoiceState& voice, BusHandle bus);
+    void SetVoicePitch(VoiceState& voice, float pitch);
+    void SetVoiceSpatialize(VoiceState& voice, int spatialize);
+    void SetVoiceLoop(VoiceState& voice, bool loop);
+    void SetVoiceCategory(VoiceState& voice, uint32_t category);
+
+    // Reports bound voices that finished as stopped right away, without waiting for Update
+    PlayState GetVoiceState(VoiceState& voice);
+} // namespace Hazel::Audio
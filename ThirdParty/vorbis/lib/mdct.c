@@ -45,6 +45,53 @@
 #include "os.h"
 #include "misc.h"
 
+/* The SIMD paths need SSE2, which every x86-64 CPU has. AVX2 is checked
+   for at runtime, the compiler is only asked for it function by function */
+#if !defined(MDCT_INTEGERIZED) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#  define MDCT_SSE2
+#  include <emmintrin.h>
+#  if defined(__GNUC__) || defined(__clang__)
+#    define MDCT_AVX2
+#    define MDCT_TARGET_AVX2 __attribute__((target("avx2")))
+#    include <immintrin.h>
+#  elif defined(_MSC_VER)
+#    define MDCT_AVX2
+#    define MDCT_TARGET_AVX2
+#    include <immintrin.h>
+#    include <intrin.h>
+#  endif
+#endif
+
+static int mdct_simd_level(int n){
+#ifdef MDCT_SSE2
+  /* the SIMD loops do at least two scalar iterations at a time */
+  if(n<64)return MDCT_SIMD_NONE;
+#  ifdef MDCT_AVX2
+#    if defined(_MSC_VER) && !defined(__clang__)
+  {
+    int info[4];
+    __cpuid(info,0);
+    if(info[0]>=7){
+      __cpuid(info,1);
+      /* OSXSAVE and AVX, and the OS saving the ymm registers */
+      if((info[2]&(1<<27)) && (info[2]&(1<<28)) && (_xgetbv(0)&6)==6){
+        __cpuidex(info,7,0);
+        if(info[1]&(1<<5))return MDCT_SIMD_AVX2;
+      }
+    }
+  }
+#    else
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("avx2"))return MDCT_SIMD_AVX2;
+#    endif
+#  endif
+  return MDCT_SIMD_SSE2;
+#else
+  (void)n;
+  return MDCT_SIMD_NONE;
+#endif
+}
+
 /* build lookups for trig functions; also pre-figure scaling and
    some window function algebra. */
 
@@ -87,6 +134,7 @@ void mdct_init(mdct_lookup *lookup,int n){
     }
   }
   lookup->scale=FLOAT_CONV(4.f/n);
+  lookup->simd=mdct_simd_level(n);
 }
 
 /* 8 point butterfly (in place, 4 register) */
@@ -393,11 +441,416 @@ STIN void mdct_bitreverse(mdct_lookup *init,
   }while(w0<w1);
 }
 
+/* SIMD versions of the transform stages. Every lane runs the same
+   float operations in the same order as the scalar code above, without
+   FMA, so the output is bit-identical whichever version runs. */
+
+#ifdef MDCT_SSE2
+
+#define MDCT_LOAD2(p) _mm_loadl_pi(_mm_setzero_ps(),(const __m64 *)(p))
+
+STIN __m128 mdct_sign_even_sse(void){
+  return _mm_castsi128_ps(_mm_set_epi32(0,(int)0x80000000,0,(int)0x80000000));
+}
+
+STIN __m128 mdct_sign_odd_sse(void){
+  return _mm_castsi128_ps(_mm_set_epi32((int)0x80000000,0,(int)0x80000000,0));
+}
+
+/* one half block of mdct_butterfly_generic, two pairs sharing tw = c1 s1 c0 s0 */
+STIN void mdct_butterfly_pairs_sse(float *x1,float *x2,__m128 tw,__m128 sign_odd){
+  __m128 a = _mm_loadu_ps(x1);
+  __m128 b = _mm_loadu_ps(x2);
+  __m128 d = _mm_sub_ps(a,b);
+  __m128 c = _mm_shuffle_ps(tw,tw,_MM_SHUFFLE(2,2,0,0));
+  __m128 s = _mm_shuffle_ps(tw,tw,_MM_SHUFFLE(3,3,1,1));
+  __m128 p = _mm_mul_ps(d,c);
+  __m128 q = _mm_mul_ps(_mm_shuffle_ps(d,d,_MM_SHUFFLE(2,3,0,1)),s);
+
+  _mm_storeu_ps(x1,_mm_add_ps(a,b));
+  /* re = r1*s + r0*c, im = r1*c - r0*s */
+  _mm_storeu_ps(x2,_mm_add_ps(p,_mm_xor_ps(q,sign_odd)));
+}
+
+static void mdct_butterfly_generic_sse(DATA_TYPE *T,
+                                       DATA_TYPE *x,
+                                       int points,
+                                       int trigint){
+  DATA_TYPE *x1 = x + points - 8;
+  DATA_TYPE *x2 = x + (points>>1) - 8;
+  __m128 sign_odd = mdct_sign_odd_sse();
+
+  do{
+    mdct_butterfly_pairs_sse(x1+4,x2+4,
+                             _mm_movelh_ps(MDCT_LOAD2(T+trigint),MDCT_LOAD2(T)),
+                             sign_odd);
+    mdct_butterfly_pairs_sse(x1,x2,
+                             _mm_movelh_ps(MDCT_LOAD2(T+trigint*3),MDCT_LOAD2(T+trigint*2)),
+                             sign_odd);
+    T+=trigint*4;
+    x1-=8;
+    x2-=8;
+  }while(x2>=x);
+}
+
+static void mdct_bitreverse_sse(mdct_lookup *init,
+                                DATA_TYPE *x){
+  int        n       = init->n;
+  int       *bit     = init->bitrev;
+  DATA_TYPE *w0      = x;
+  DATA_TYPE *w1      = x = w0+(n>>1);
+  DATA_TYPE *T       = init->trig+n;
+  __m128 sign_even   = mdct_sign_even_sse();
+  __m128 sign_odd    = mdct_sign_odd_sse();
+  __m128 even        = _mm_castsi128_ps(_mm_set_epi32(0,-1,0,-1));
+  __m128 half        = _mm_set1_ps(.5f);
+
+  do{
+    __m128 a  = _mm_movelh_ps(MDCT_LOAD2(x+bit[0]),MDCT_LOAD2(x+bit[2]));
+    __m128 b  = _mm_movelh_ps(MDCT_LOAD2(x+bit[1]),MDCT_LOAD2(x+bit[3]));
+    __m128 t  = _mm_loadu_ps(T);
+    __m128 sum  = _mm_add_ps(a,b);
+    __m128 diff = _mm_sub_ps(a,b);
+
+    /* v = r1 r0, h = HALVE of the scalar r0 r1 */
+    __m128 v  = _mm_or_ps(_mm_and_ps(even,sum),_mm_andnot_ps(even,diff));
+    __m128 h  = _mm_or_ps(_mm_and_ps(even,diff),_mm_andnot_ps(even,sum));
+    __m128 p  = _mm_mul_ps(v,_mm_shuffle_ps(t,t,_MM_SHUFFLE(2,2,0,0)));
+    __m128 q  = _mm_mul_ps(_mm_shuffle_ps(v,v,_MM_SHUFFLE(2,3,0,1)),
+                           _mm_shuffle_ps(t,t,_MM_SHUFFLE(3,3,1,1)));
+    __m128 r  = _mm_add_ps(q,_mm_xor_ps(p,sign_odd)); /* r2 r3 */
+
+    h = _mm_mul_ps(_mm_shuffle_ps(h,h,_MM_SHUFFLE(2,3,0,1)),half);
+
+    w1 -= 4;
+    _mm_storeu_ps(w0,_mm_add_ps(h,r));
+    r  = _mm_add_ps(_mm_xor_ps(h,sign_odd),_mm_xor_ps(r,sign_even));
+    _mm_storeu_ps(w1,_mm_shuffle_ps(r,r,_MM_SHUFFLE(1,0,3,2)));
+
+    T     += 4;
+    bit   += 4;
+    w0    += 4;
+  }while(w0<w1);
+}
+
+static void mdct_rotate_in_sse(mdct_lookup *init, DATA_TYPE *in, DATA_TYPE *out){
+  int n=init->n;
+  int n2=n>>1;
+  int n4=n>>2;
+  __m128 sign_even = mdct_sign_even_sse();
+  __m128 sign_odd  = mdct_sign_odd_sse();
+
+  DATA_TYPE *iX = in+n2-7;
+  DATA_TYPE *oX = out+n2+n4;
+  DATA_TYPE *T  = init->trig+n4;
+
+  do{
+    __m128 y = _mm_shuffle_ps(_mm_loadu_ps(iX),_mm_loadu_ps(iX+3),_MM_SHUFFLE(3,1,2,0));
+    __m128 u = _mm_shuffle_ps(y,y,_MM_SHUFFLE(2,3,0,1));
+    __m128 t = _mm_loadu_ps(T);
+    __m128 r = _mm_xor_ps(_mm_mul_ps(u,_mm_shuffle_ps(t,t,_MM_SHUFFLE(1,1,3,3))),sign_even);
+
+    oX -= 4;
+    _mm_storeu_ps(oX,_mm_sub_ps(r,_mm_mul_ps(y,_mm_shuffle_ps(t,t,_MM_SHUFFLE(0,0,2,2)))));
+    iX -= 8;
+    T  += 4;
+  }while(iX>=in);
+
+  iX = in+n2-8;
+  oX = out+n2+n4;
+  T  = init->trig+n4;
+
+  do{
+    __m128 y = _mm_shuffle_ps(_mm_loadu_ps(iX+4),_mm_loadu_ps(iX),_MM_SHUFFLE(2,0,2,0));
+    __m128 u = _mm_shuffle_ps(y,y,_MM_SHUFFLE(2,3,0,1));
+    __m128 t;
+
+    T -= 4;
+    t = _mm_loadu_ps(T);
+    _mm_storeu_ps(oX,_mm_add_ps(_mm_mul_ps(u,_mm_shuffle_ps(t,t,_MM_SHUFFLE(0,0,2,2))),
+                                _mm_xor_ps(_mm_mul_ps(y,_mm_shuffle_ps(t,t,_MM_SHUFFLE(1,1,3,3))),sign_odd)));
+    iX -= 8;
+    oX += 4;
+  }while(iX>=in);
+}
+
+static void mdct_rotate_out_sse(mdct_lookup *init, DATA_TYPE *out){
+  int n=init->n;
+  int n2=n>>1;
+  int n4=n>>2;
+  __m128 sign = _mm_set1_ps(-0.f);
+
+  DATA_TYPE *oX1=out+n2+n4;
+  DATA_TYPE *oX2=out+n2+n4;
+  DATA_TYPE *iX =out;
+  DATA_TYPE *T  =init->trig+n2;
+
+  do{
+    __m128 x0 = _mm_loadu_ps(iX);
+    __m128 x1 = _mm_loadu_ps(iX+4);
+    __m128 t0 = _mm_loadu_ps(T);
+    __m128 t1 = _mm_loadu_ps(T+4);
+    __m128 re = _mm_shuffle_ps(x0,x1,_MM_SHUFFLE(2,0,2,0));
+    __m128 im = _mm_shuffle_ps(x0,x1,_MM_SHUFFLE(3,1,3,1));
+    __m128 tr = _mm_shuffle_ps(t0,t1,_MM_SHUFFLE(2,0,2,0));
+    __m128 ti = _mm_shuffle_ps(t0,t1,_MM_SHUFFLE(3,1,3,1));
+    __m128 a  = _mm_sub_ps(_mm_mul_ps(re,ti),_mm_mul_ps(im,tr));
+    __m128 b  = _mm_add_ps(_mm_mul_ps(re,tr),_mm_mul_ps(im,ti));
+
+    oX1-=4;
+    _mm_storeu_ps(oX1,_mm_shuffle_ps(a,a,_MM_SHUFFLE(0,1,2,3)));
+    _mm_storeu_ps(oX2,_mm_xor_ps(b,sign));
+
+    oX2+=4;
+    iX +=8;
+    T  +=8;
+  }while(iX<oX1);
+
+  iX=out+n2+n4;
+  oX1=out+n4;
+  oX2=oX1;
+
+  do{
+    __m128 v;
+    oX1-=4;
+    iX-=4;
+
+    v = _mm_loadu_ps(iX);
+    _mm_storeu_ps(oX1,v);
+    _mm_storeu_ps(oX2,_mm_xor_ps(_mm_shuffle_ps(v,v,_MM_SHUFFLE(0,1,2,3)),sign));
+
+    oX2+=4;
+  }while(oX2<iX);
+
+  iX=out+n2+n4;
+  oX1=out+n2+n4;
+  oX2=out+n2;
+  do{
+    __m128 v = _mm_loadu_ps(iX);
+    oX1-=4;
+    _mm_storeu_ps(oX1,_mm_shuffle_ps(v,v,_MM_SHUFFLE(0,1,2,3)));
+    iX+=4;
+  }while(oX1>oX2);
+}
+
+#endif
+
+#ifdef MDCT_AVX2
+
+#define MDCT_LOAD4(lo,hi) _mm256_insertf128_ps(_mm256_castps128_ps256(lo),(hi),1)
+
+MDCT_TARGET_AVX2
+static void mdct_butterfly_generic_avx2(DATA_TYPE *T,
+                                        DATA_TYPE *x,
+                                        int points,
+                                        int trigint){
+  DATA_TYPE *x1 = x + points - 8;
+  DATA_TYPE *x2 = x + (points>>1) - 8;
+  __m256 sign_odd = _mm256_castsi256_ps(_mm256_set1_epi64x((long long)0x8000000000000000ull));
+
+  do{
+    /* pairs 0 2 4 6 of the block take every trigint'th twiddle from the top down */
+    __m256 tw = MDCT_LOAD4(_mm_movelh_ps(MDCT_LOAD2(T+trigint*3),MDCT_LOAD2(T+trigint*2)),
+                           _mm_movelh_ps(MDCT_LOAD2(T+trigint),MDCT_LOAD2(T)));
+    __m256 a = _mm256_loadu_ps(x1);
+    __m256 b = _mm256_loadu_ps(x2);
+    __m256 d = _mm256_sub_ps(a,b);
+    __m256 p = _mm256_mul_ps(d,_mm256_moveldup_ps(tw));
+    __m256 q = _mm256_mul_ps(_mm256_permute_ps(d,_MM_SHUFFLE(2,3,0,1)),_mm256_movehdup_ps(tw));
+
+    _mm256_storeu_ps(x1,_mm256_add_ps(a,b));
+    _mm256_storeu_ps(x2,_mm256_add_ps(p,_mm256_xor_ps(q,sign_odd)));
+
+    T+=trigint*4;
+    x1-=8;
+    x2-=8;
+  }while(x2>=x);
+}
+
+MDCT_TARGET_AVX2
+static void mdct_bitreverse_avx2(mdct_lookup *init,
+                                 DATA_TYPE *x){
+  int        n       = init->n;
+  int       *bit     = init->bitrev;
+  DATA_TYPE *w0      = x;
+  DATA_TYPE *w1      = x = w0+(n>>1);
+  DATA_TYPE *T       = init->trig+n;
+  __m256 sign_odd    = _mm256_castsi256_ps(_mm256_set1_epi64x((long long)0x8000000000000000ull));
+  __m256 sign_even   = _mm256_castsi256_ps(_mm256_set1_epi64x(0x80000000ll));
+  __m256 half        = _mm256_set1_ps(.5f);
+
+  /* two iterations of the scalar loop at a time */
+  do{
+    __m256 a  = MDCT_LOAD4(_mm_movelh_ps(MDCT_LOAD2(x+bit[0]),MDCT_LOAD2(x+bit[2])),
+                           _mm_movelh_ps(MDCT_LOAD2(x+bit[4]),MDCT_LOAD2(x+bit[6])));
+    __m256 b  = MDCT_LOAD4(_mm_movelh_ps(MDCT_LOAD2(x+bit[1]),MDCT_LOAD2(x+bit[3])),
+                           _mm_movelh_ps(MDCT_LOAD2(x+bit[5]),MDCT_LOAD2(x+bit[7])));
+    __m256 t  = _mm256_loadu_ps(T);
+    __m256 sum  = _mm256_add_ps(a,b);
+    __m256 diff = _mm256_sub_ps(a,b);
+    __m256 v  = _mm256_blend_ps(sum,diff,0xaa);
+    __m256 h  = _mm256_blend_ps(diff,sum,0xaa);
+    __m256 p  = _mm256_mul_ps(v,_mm256_moveldup_ps(t));
+    __m256 q  = _mm256_mul_ps(_mm256_permute_ps(v,_MM_SHUFFLE(2,3,0,1)),_mm256_movehdup_ps(t));
+    __m256 r  = _mm256_add_ps(q,_mm256_xor_ps(p,sign_odd));
+
+    h = _mm256_mul_ps(_mm256_permute_ps(h,_MM_SHUFFLE(2,3,0,1)),half);
+
+    w1 -= 8;
+    _mm256_storeu_ps(w0,_mm256_add_ps(h,r));
+    r  = _mm256_add_ps(_mm256_xor_ps(h,sign_odd),_mm256_xor_ps(r,sign_even));
+    r  = _mm256_permute_ps(r,_MM_SHUFFLE(1,0,3,2));
+    _mm256_storeu_ps(w1,_mm256_permute2f128_ps(r,r,1));
+
+    T     += 8;
+    bit   += 8;
+    w0    += 8;
+  }while(w0<w1);
+}
+
+MDCT_TARGET_AVX2
+static void mdct_rotate_out_avx2(mdct_lookup *init, DATA_TYPE *out){
+  int n=init->n;
+  int n2=n>>1;
+  int n4=n>>2;
+  __m256 sign = _mm256_set1_ps(-0.f);
+  __m256i reverse = _mm256_set_epi32(0,1,2,3,4,5,6,7);
+
+  DATA_TYPE *oX1=out+n2+n4;
+  DATA_TYPE *oX2=out+n2+n4;
+  DATA_TYPE *iX =out;
+  DATA_TYPE *T  =init->trig+n2;
+
+  do{
+    __m256 x0 = _mm256_loadu_ps(iX);
+    __m256 x1 = _mm256_loadu_ps(iX+8);
+    __m256 t0 = _mm256_loadu_ps(T);
+    __m256 t1 = _mm256_loadu_ps(T+8);
+    /* deinterleaved per 128 bit lane, pairs 0 1 4 5 2 3 6 7 */
+    __m256 re = _mm256_shuffle_ps(x0,x1,_MM_SHUFFLE(2,0,2,0));
+    __m256 im = _mm256_shuffle_ps(x0,x1,_MM_SHUFFLE(3,1,3,1));
+    __m256 tr = _mm256_shuffle_ps(t0,t1,_MM_SHUFFLE(2,0,2,0));
+    __m256 ti = _mm256_shuffle_ps(t0,t1,_MM_SHUFFLE(3,1,3,1));
+    __m256 a  = _mm256_sub_ps(_mm256_mul_ps(re,ti),_mm256_mul_ps(im,tr));
+    __m256 b  = _mm256_add_ps(_mm256_mul_ps(re,tr),_mm256_mul_ps(im,ti));
+
+    a = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(a),_MM_SHUFFLE(3,1,2,0)));
+    b = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(b),_MM_SHUFFLE(3,1,2,0)));
+
+    oX1-=8;
+    _mm256_storeu_ps(oX1,_mm256_permutevar8x32_ps(a,reverse));
+    _mm256_storeu_ps(oX2,_mm256_xor_ps(b,sign));
+
+    oX2+=8;
+    iX +=16;
+    T  +=16;
+  }while(iX<oX1);
+
+  iX=out+n2+n4;
+  oX1=out+n4;
+  oX2=oX1;
+
+  do{
+    __m256 v;
+    oX1-=8;
+    iX-=8;
+
+    v = _mm256_loadu_ps(iX);
+    _mm256_storeu_ps(oX1,v);
+    _mm256_storeu_ps(oX2,_mm256_xor_ps(_mm256_permutevar8x32_ps(v,reverse),sign));
+
+    oX2+=8;
+  }while(oX2<iX);
+
+  iX=out+n2+n4;
+  oX1=out+n2+n4;
+  oX2=out+n2;
+  do{
+    __m256 v = _mm256_loadu_ps(iX);
+    oX1-=8;
+    _mm256_storeu_ps(oX1,_mm256_permutevar8x32_ps(v,reverse));
+    iX+=8;
+  }while(oX1>oX2);
+}
+
+#endif
+
+#ifdef MDCT_SSE2
+
+typedef void (*mdct_butterfly_func)(DATA_TYPE *T,DATA_TYPE *x,int points,int trigint);
+
+/* mdct_butterflies with the first and generic stages vectorized, the
+   first stage is the generic one with a trigint of 4 */
+static void mdct_butterflies_simd(mdct_lookup *init,
+                                  DATA_TYPE *x,
+                                  int points){
+
+  DATA_TYPE *T=init->trig;
+  int stages=init->log2n-5;
+  int i,j;
+  mdct_butterfly_func generic=mdct_butterfly_generic_sse;
+
+#ifdef MDCT_AVX2
+  if(init->simd==MDCT_SIMD_AVX2)
+    generic=mdct_butterfly_generic_avx2;
+#endif
+
+  if(--stages>0){
+    generic(T,x,points,4);
+  }
+
+  for(i=1;--stages>0;i++){
+    for(j=0;j<(1<<i);j++)
+      generic(T,x+(points>>i)*j,points>>i,4<<i);
+  }
+
+  for(j=0;j<points;j+=32)
+    mdct_butterfly_32(x+j);
+
+}
+
+static void mdct_bitreverse_simd(mdct_lookup *init,
+                                 DATA_TYPE *x){
+#ifdef MDCT_AVX2
+  if(init->simd==MDCT_SIMD_AVX2){
+    mdct_bitreverse_avx2(init,x);
+    return;
+  }
+#endif
+  mdct_bitreverse_sse(init,x);
+}
+
+static void mdct_backward_simd(mdct_lookup *init, DATA_TYPE *in, DATA_TYPE *out){
+  int n=init->n;
+  int n2=n>>1;
+
+  mdct_rotate_in_sse(init,in,out);
+  mdct_butterflies_simd(init,out+n2,n2);
+  mdct_bitreverse_simd(init,out);
+
+#ifdef MDCT_AVX2
+  if(init->simd==MDCT_SIMD_AVX2){
+    mdct_rotate_out_avx2(init,out);
+    return;
+  }
+#endif
+  mdct_rotate_out_sse(init,out);
+}
+
+#endif
+
 void mdct_backward(mdct_lookup *init, DATA_TYPE *in, DATA_TYPE *out){
   int n=init->n;
   int n2=n>>1;
   int n4=n>>2;
 
+#ifdef MDCT_SSE2
+  if(init->simd!=MDCT_SIMD_NONE){
+    mdct_backward_simd(init,in,out);
+    return;
+  }
+#endif
+
   /* rotate */
 
   DATA_TYPE *iX = in+n2-7;
@@ -544,8 +997,16 @@ void mdct_forward(mdct_lookup *init, DATA_TYPE *in, DATA_TYPE *out){
   }
 
 
-  mdct_butterflies(init,w+n2,n2);
-  mdct_bitreverse(init,w);
+#ifdef MDCT_SSE2
+  if(init->simd!=MDCT_SIMD_NONE){
+    mdct_butterflies_simd(init,w+n2,n2);
+    mdct_bitreverse_simd(init,w);
+  }else
+#endif
+  {
+    mdct_butterflies(init,w+n2,n2);
+    mdct_bitreverse(init,w);
+  }
 
   /* roatate + window */
 
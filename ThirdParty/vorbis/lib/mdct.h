@@ -60,8 +60,13 @@ typedef struct {
   int       *bitrev;
 
   DATA_TYPE scale;
+  int       simd; /* MDCT_SIMD_* picked by mdct_init for this CPU */
 } mdct_lookup;
 
+#define MDCT_SIMD_NONE 0
+#define MDCT_SIMD_SSE2 1
+#define MDCT_SIMD_AVX2 2
+
 extern void mdct_init(mdct_lookup *lookup,int n);
 extern void mdct_clear(mdct_lookup *l);
 extern void mdct_forward(mdct_lookup *init, DATA_TYPE *in, DATA_TYPE *out);
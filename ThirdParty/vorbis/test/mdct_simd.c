@@ -0,0 +1,98 @@
+/********************************************************************
+ *                                                                  *
+ * THIS FILE IS PART OF THE OggVorbis SOFTWARE CODEC SOURCE CODE.   *
+ * USE, DISTRIBUTION AND REPRODUCTION OF THIS LIBRARY SOURCE IS     *
+ * GOVERNED BY A BSD-STYLE SOURCE LICENSE INCLUDED WITH THIS SOURCE *
+ * IN 'COPYING'. PLEASE READ THESE TERMS BEFORE DISTRIBUTING.       *
+ *                                                                  *
+ * THE OggVorbis SOURCE CODE IS (C) COPYRIGHT 1994-2009             *
+ * by the Xiph.Org Foundation https://xiph.org/                     *
+ *                                                                  *
+ ********************************************************************
+
+ function: check the SIMD mdct paths against the scalar one
+
+ Every SIMD level the CPU supports has to give bit-exact output,
+ forward and backward, for all block sizes from 64 to 8192.
+
+ ********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mdct.h"
+
+#define TRIALS 50
+
+static unsigned int seed=0x12345678;
+
+/* deterministic, so a failure reproduces on the same machine */
+static float random_sample(float scale){
+  seed=seed*1664525u+1013904223u;
+  return ((float)(seed>>8)/(float)(1<<24)-.5f)*scale;
+}
+
+static void fill(float *in,int n,int trial){
+  int i;
+  /* mostly loud noise, plus some denormal range input and silence */
+  float scale=(trial%5==0?1e-30f:1000.f);
+  for(i=0;i<n;i++)in[i]=random_sample(scale);
+  if(trial==1)memset(in,0,n*sizeof(*in));
+}
+
+static int check(int n){
+  mdct_lookup l;
+  int detected,level,trial,bad=0;
+  float *in=malloc(n*sizeof(*in));
+  float *ref=malloc(n*sizeof(*ref));
+  float *out=malloc(n*sizeof(*out));
+
+  memset(&l,0,sizeof(l));
+  mdct_init(&l,n);
+  detected=l.simd;
+
+  for(trial=0;trial<TRIALS;trial++){
+    fill(in,n,trial);
+
+    l.simd=MDCT_SIMD_NONE;
+    memset(ref,0,n*sizeof(*ref));
+    mdct_backward(&l,in,ref);
+    for(level=MDCT_SIMD_SSE2;level<=detected;level++){
+      l.simd=level;
+      memset(out,0x55,n*sizeof(*out));
+      mdct_backward(&l,in,out);
+      if(memcmp(out,ref,n*sizeof(*out))){
+        fprintf(stderr,"mdct_backward n=%d simd=%d trial %d differs\n",n,level,trial);
+        bad++;
+      }
+    }
+
+    /* forward only writes the first n/2 */
+    l.simd=MDCT_SIMD_NONE;
+    mdct_forward(&l,in,ref);
+    for(level=MDCT_SIMD_SSE2;level<=detected;level++){
+      l.simd=level;
+      memset(out,0x55,n*sizeof(*out));
+      mdct_forward(&l,in,out);
+      if(memcmp(out,ref,n/2*sizeof(*out))){
+        fprintf(stderr,"mdct_forward n=%d simd=%d trial %d differs\n",n,level,trial);
+        bad++;
+      }
+    }
+  }
+
+  printf("n=%d: simd level %d, %s\n",n,detected,bad?"FAILED":"ok");
+
+  mdct_clear(&l);
+  free(in);
+  free(ref);
+  free(out);
+  return bad;
+}
+
+int main(void){
+  int n,bad=0;
+  for(n=64;n<=8192;n<<=1)
+    bad+=check(n);
+  return bad?EXIT_FAILURE:EXIT_SUCCESS;
+}